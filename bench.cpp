@@ -0,0 +1,371 @@
+// Benchmarks behind the book's performance claims, one table per section.
+// Usage: bench [section]...      (no arguments runs every section)
+//   latency     passive adds against aggressive orders
+//   contention  throughput of 1-16 threads sharing one book, per lock policy
+//   counters    cache misses per sweep across 1, 10 and 100 levels
+//   combo       two-leg combos against the same legs sent independently
+//   memory      bytes per resting order, default and presized books
+// Build against the library sources, for example:
+//   g++ -std=c++17 -O2 bench.cpp orderbook.cpp combo.cpp implied.cpp
+//       depth_index.cpp fee_engine.cpp logger.cpp -o bench -lpthread
+// and rebuild with -DORDERBOOK_PREFETCH_DISTANCE=0 or
+// -DORDERBOOK_INSTRUMENTATION=0 to compare compile-time policies.
+#include "combo.hpp"
+#include "orderbook.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <random>
+#include <thread>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    constexpr int64_t MID = 100000;
+
+    uint64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    Order limit(uint64_t id, Side side, int64_t priceTick, uint32_t quantity, uint32_t ownerId,
+                TimeInForce tif = TimeInForce::GTC) {
+        return {id, side, priceTick, quantity, OrderType::Limit, tif, ownerId, 0};
+    }
+
+    void printPercentiles(const char* label, std::vector<uint64_t>& samples) {
+        std::sort(samples.begin(), samples.end());
+        double total = 0;
+        for (uint64_t sample : samples) total += sample;
+        auto at = [&](double q) {
+            return static_cast<unsigned long long>(samples[std::min(samples.size() - 1, size_t(q * samples.size()))]);
+        };
+        std::printf("  %-24s %8llu %8llu %8llu %8.0f\n", label, at(0.50), at(0.99), at(0.999),
+                    total / samples.size());
+    }
+
+    // Per-order latency on a single-owner book (LockPolicy::None), each
+    // sample including one clock read. Passive bids rest below a steady
+    // ask wall; each aggressor is an IOC taking one lot off the wall, which
+    // is topped up outside the timed region.
+    void benchLatency() {
+        constexpr int OPS = 200000;
+        std::mt19937 rng(1);
+        std::vector<uint64_t> passive, aggressive;
+        passive.reserve(OPS);
+        aggressive.reserve(OPS);
+
+        OrderBook book(4096, LockPolicy::None);
+        uint64_t id = 1;
+        for (int i = 0; i < 1000; ++i) book.submitOrder(limit(id++, Side::Sell, MID + i % 10, 1, 1));
+
+        std::vector<OrderHandle> resting;
+        for (int i = 0; i < OPS; ++i) {
+            Order bid = limit(id++, Side::Buy, MID - 1 - int64_t(rng() % 100), 1 + rng() % 10, 2);
+            uint64_t start = nowNs();
+            resting.push_back(book.submitOrder(bid));
+            passive.push_back(nowNs() - start);
+            if (resting.size() == 1000) {
+                for (OrderHandle handle : resting) book.cancel(handle);
+                resting.clear();
+            }
+
+            Order take = limit(id++, Side::Buy, MID + 9, 1, 3, TimeInForce::IOC);
+            start = nowNs();
+            book.submitOrder(take);
+            aggressive.push_back(nowNs() - start);
+            book.submitOrder(limit(id++, Side::Sell, MID + i % 10, 1, 1));
+        }
+
+        std::printf("%-26s %8s %8s %8s %8s\n", "latency, ns per order", "p50", "p99", "p99.9", "mean");
+        printPercentiles("passive add", passive);
+        printPercentiles("aggressive, one fill", aggressive);
+    }
+
+    const char* policyName(LockPolicy policy) {
+        switch (policy) {
+            case LockPolicy::None: return "none";
+            case LockPolicy::SpinLock: return "spin";
+            case LockPolicy::TicketLock: return "ticket";
+            case LockPolicy::Mutex: return "mutex";
+        }
+        return "?";
+    }
+
+    // Million operations per second across all threads over a fixed wall
+    // time, so an oversubscribed FIFO lock shows as a collapse rather than a
+    // hang. Each thread is its own owner: it rests orders on both sides near
+    // the mid, cancels them by handle from a ring of 64, and sends a
+    // crossing IOC every eighth op.
+    double contendedMops(LockPolicy policy, int threads) {
+        constexpr size_t RING = 64;
+        constexpr auto RUN_TIME = std::chrono::milliseconds(300);
+        OrderBook book(size_t(threads) * RING * 2, policy);
+        std::atomic<int> ready{0};
+        std::atomic<bool> go{false};
+        std::atomic<bool> stop{false};
+        std::atomic<uint64_t> totalOps{0};
+
+        auto worker = [&](uint32_t ownerId) {
+            std::mt19937 rng(ownerId);
+            std::vector<OrderHandle> ring(RING);
+            uint64_t clientId = 1;
+            uint64_t i = 0;
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+
+            for (; !stop.load(std::memory_order_relaxed); ++i) {
+                Side side = (i & 1) ? Side::Sell : Side::Buy;
+                if (i % 8 == 7) {
+                    int64_t price = side == Side::Buy ? MID + 64 : MID - 64;
+                    book.submitOrder(limit(clientId++, side, price, 1, ownerId, TimeInForce::IOC));
+                    continue;
+                }
+                OrderHandle& slot = ring[i % RING];
+                book.cancel(slot);
+                int64_t offset = 1 + int64_t(rng() % 50);
+                int64_t price = side == Side::Buy ? MID - offset : MID + offset;
+                slot = book.submitOrder(limit(clientId++, side, price, 1 + rng() % 10, ownerId));
+            }
+            totalOps.fetch_add(i);
+        };
+
+        std::vector<std::thread> pool;
+        for (int t = 0; t < threads; ++t) pool.emplace_back(worker, uint32_t(t + 1));
+        while (ready.load() < threads) std::this_thread::yield();
+        uint64_t start = nowNs();
+        go.store(true, std::memory_order_release);
+        std::this_thread::sleep_for(RUN_TIME);
+        stop.store(true, std::memory_order_relaxed);
+        for (std::thread& thread : pool) thread.join();
+        return double(totalOps.load()) * 1e3 / double(nowNs() - start);
+    }
+
+    void benchContention() {
+        const int counts[] = {1, 2, 4, 8, 16};
+        std::printf("contention, Mops/s (%u hardware threads)\n", std::thread::hardware_concurrency());
+        std::printf("  %-8s", "policy");
+        for (int threads : counts) std::printf(" %7dT", threads);
+        std::printf("\n  %-8s %8.2f\n", policyName(LockPolicy::None), contendedMops(LockPolicy::None, 1));
+        for (LockPolicy policy : {LockPolicy::SpinLock, LockPolicy::TicketLock, LockPolicy::Mutex}) {
+            std::printf("  %-8s", policyName(policy));
+            for (int threads : counts) {
+                std::printf(" %8.2f", contendedMops(policy, threads));
+                std::fflush(stdout);
+            }
+            std::printf("\n");
+        }
+    }
+
+    // One user-space hardware counter; reads 0 where perf_event_open is
+    // unavailable (containers, perf_event_paranoid), and valid() says so.
+    class PerfCounter {
+    public:
+        PerfCounter(uint32_t type, uint64_t config) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd_ = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+        ~PerfCounter() {
+            if (fd_ >= 0) ::close(fd_);
+        }
+        PerfCounter(const PerfCounter&) = delete;
+        PerfCounter& operator=(const PerfCounter&) = delete;
+
+        bool valid() const { return fd_ >= 0; }
+        void start() {
+            if (fd_ >= 0) ::ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        void stop() {
+            if (fd_ >= 0) ::ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+        }
+        uint64_t read() const {
+            uint64_t value = 0;
+            if (fd_ >= 0 && ::read(fd_, &value, sizeof(value)) != sizeof(value)) value = 0;
+            return value;
+        }
+
+    private:
+        int fd_ = -1;
+    };
+
+    void printCounter(const PerfCounter& counter, int reps) {
+        if (counter.valid()) {
+            std::printf(" %12.1f", double(counter.read()) / reps);
+        } else {
+            std::printf(" %12s", "n/a");
+        }
+    }
+
+    // An IOC buy sweeping `levels` ask levels of 20 one-lot orders each. The
+    // asks are interleaved with throwaway bids so their pool slots are
+    // scattered the way a live book's are, which is what the prefetch in the
+    // match loop is for. Only the sweep itself is counted.
+    void benchCounters() {
+        constexpr int REPS = 200;
+        constexpr int PER_LEVEL = 20;
+        std::printf("counters, per sweep (PREFETCH_DISTANCE %u)\n", PREFETCH_DISTANCE);
+        std::printf("  %-8s %10s %12s %12s\n", "levels", "ns", "cache-miss", "L1D-miss");
+
+        for (int levels : {1, 10, 100}) {
+            PerfCounter cacheMisses(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+            PerfCounter l1dMisses(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                                                          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+            OrderBook book(size_t(levels) * PER_LEVEL * 2 + 1, LockPolicy::None);
+            std::mt19937 rng(1);
+            uint64_t id = 1;
+            uint64_t totalNs = 0;
+            std::vector<OrderHandle> filler;
+
+            for (int rep = 0; rep < REPS; ++rep) {
+                for (int level = 0; level < levels; ++level) {
+                    for (int k = 0; k < PER_LEVEL; ++k) {
+                        book.submitOrder(limit(id++, Side::Sell, MID + level, 1, 1));
+                        filler.push_back(book.submitOrder(limit(id++, Side::Buy, MID - 1 - int64_t(rng() % 500), 1, 3)));
+                    }
+                }
+                Order sweep = limit(id++, Side::Buy, MID + levels, uint32_t(levels * PER_LEVEL), 2, TimeInForce::IOC);
+                uint64_t start = nowNs();
+                cacheMisses.start();
+                l1dMisses.start();
+                book.submitOrder(sweep);
+                l1dMisses.stop();
+                cacheMisses.stop();
+                totalNs += nowNs() - start;
+
+                for (OrderHandle handle : filler) book.cancel(handle);
+                filler.clear();
+            }
+
+            std::printf("  %-8d %10.0f", levels, double(totalNs) / REPS);
+            printCounter(cacheMisses, REPS);
+            printCounter(l1dMisses, REPS);
+            std::printf("\n");
+        }
+    }
+
+    // A spot-perp basis trade: buy one lot in the spot book and sell one in
+    // the perp book, each against a single deep resting order so every call
+    // fills. The combo locks both books and plans both legs before either
+    // executes; the baseline is the same two IOCs sent one after the other
+    // with no all-or-none guarantee.
+    void benchCombo() {
+        constexpr int OPS = 200000;
+        OrderBook spot(64, LockPolicy::Mutex);
+        OrderBook perp(64, LockPolicy::Mutex);
+        spot.submitOrder(limit(1, Side::Sell, 1000, UINT32_MAX, 1));
+        perp.submitOrder(limit(1, Side::Buy, 1010, UINT32_MAX, 1));
+        uint64_t id = 1;
+
+        uint64_t start = nowNs();
+        for (int i = 0; i < OPS; ++i) {
+            spot.submitOrder(limit(id, Side::Buy, 1000, 1, 2, TimeInForce::IOC));
+            perp.submitOrder(limit(id++, Side::Sell, 1010, 1, 2, TimeInForce::IOC));
+        }
+        double independentNs = double(nowNs() - start) / OPS;
+
+        ComboCoordinator coordinator;
+        ComboOrder combo{0, 2, 1, 0, 2, {{{&spot, Side::Buy, 1}, {&perp, Side::Sell, 1}}}};
+        int filled = 0;
+        start = nowNs();
+        for (int i = 0; i < OPS; ++i) {
+            combo.id = id++;
+            filled += coordinator.submit(combo).status == ComboStatus::Filled;
+        }
+        double comboNs = double(nowNs() - start) / OPS;
+
+        std::printf("combo, ns per two-leg trade\n");
+        std::printf("  %-24s %8.0f\n", "independent IOC legs", independentNs);
+        std::printf("  %-24s %8.0f  (%d/%d filled)\n", "combo", comboNs, filled, OPS);
+    }
+
+    void printMemory(const char* label, size_t orders, const MemoryUsage& usage) {
+        std::printf("  %-10s %8zu %11zu %7zu %10zu %10zu %8zu %8zu %8zu %8zu %8zu %10zu\n", label, orders,
+                    usage.total(), usage.bytesPerOrder(), usage.orderStorage, usage.idIndex, usage.levels,
+                    usage.queues, usage.rings, usage.depthIndex, usage.positions, usage.hibernated);
+    }
+
+    // Resting orders spread over 500 levels a side and 64 owners, once in a
+    // default-constructed book that grows as orders arrive and once in a
+    // book presized for the count. The 10k default book is then hibernated.
+    void benchMemory() {
+        std::printf("memory, bytes\n");
+        std::printf("  default     OrderBook(): sized for %zu orders, grown as orders arrive\n",
+                    OrderBook::COMPACT_BOOK_ORDERS);
+        std::printf("  presized    OrderBook(orders): capacity reserved up front; no row at 0 orders\n");
+        std::printf("  hibernated  the 10000-order default book after hibernate()\n");
+        std::printf("  %-10s %8s %11s %7s %10s %10s %8s %8s %8s %8s %8s %10s\n", "book", "orders", "total",
+                    "/order", "pool", "ids", "levels", "queues", "rings", "depth", "posns", "hibernated");
+
+        for (size_t orders : {size_t(0), size_t(100), size_t(10000), size_t(1000000)}) {
+            auto fill = [orders](OrderBook& book) {
+                for (size_t i = 0; i < orders; ++i) {
+                    Side side = (i & 1) ? Side::Sell : Side::Buy;
+                    int64_t offset = 1 + int64_t(i / 2 % 500);
+                    book.submitOrder(limit(i + 1, side, side == Side::Buy ? MID - offset : MID + offset, 1,
+                                           uint32_t(i % 64 + 1)));
+                }
+            };
+
+            OrderBook grown;
+            fill(grown);
+            printMemory("default", orders, grown.memoryUsage());
+
+            // Presized for nothing is below the default floor, not a comparison
+            if (orders > 0) {
+                OrderBook presized(orders);
+                fill(presized);
+                printMemory("presized", orders, presized.memoryUsage());
+            }
+
+            if (orders == 10000 && grown.hibernate()) printMemory("hibernated", orders, grown.memoryUsage());
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    struct Section {
+        const char* name;
+        void (*run)();
+    };
+    const Section sections[] = {
+        {"latency", benchLatency},
+        {"contention", benchContention},
+        {"counters", benchCounters},
+        {"combo", benchCombo},
+        {"memory", benchMemory},
+    };
+
+    for (int i = 1; i < argc; ++i) {
+        bool known = false;
+        for (const Section& section : sections) known |= std::strcmp(argv[i], section.name) == 0;
+        if (!known) {
+            std::fprintf(stderr, "usage: %s [section]...\nsections:", argv[0]);
+            for (const Section& section : sections) std::fprintf(stderr, " %s", section.name);
+            std::fprintf(stderr, "\n");
+            return 2;
+        }
+    }
+
+    for (const Section& section : sections) {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; ++i) selected |= std::strcmp(argv[i], section.name) == 0;
+        if (selected) {
+            section.run();
+            std::printf("\n");
+        }
+    }
+    return 0;
+}
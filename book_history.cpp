@@ -0,0 +1,158 @@
+#include "book_history.hpp"
+#include <algorithm>
+#include <numeric>
+
+BookHistory::BookHistory(OrderBook& book, size_t checkpointInterval, size_t replayCapacity)
+    : book_(book),
+      checkpointInterval_(checkpointInterval ? checkpointInterval : 1),
+      replay_(std::make_unique<OrderBook>(replayCapacity, LockPolicy::None)) {
+    // The book may already hold orders; that state is the first checkpoint
+    checkpoints_.push_back({0, 0, book_.getOrderCount(), {}});
+    book_.writeSnapshot(checkpoints_.back().image);
+}
+
+OrderHandle BookHistory::submitOrder(uint64_t timestamp, const Order& order, std::vector<Fill>* fills) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    OrderHandle handle = book_.submitOrder(order, fills);
+    append(timestamp, EventType::Submit, order);
+    return handle;
+}
+
+bool BookHistory::cancelOrder(uint64_t timestamp, uint32_t ownerId, uint64_t clientOrderId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool cancelled = book_.cancelOrder(ownerId, clientOrderId);
+    Order target{};
+    target.id = clientOrderId;
+    target.ownerId = ownerId;
+    append(timestamp, EventType::CancelClient, target);
+    return cancelled;
+}
+
+std::vector<Fill> BookHistory::modifyOrder(uint64_t timestamp, uint32_t ownerId, uint64_t clientOrderId,
+                                           int64_t newPrice, uint32_t newQty) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Fill> fills = book_.modifyOrder(ownerId, clientOrderId, newPrice, newQty);
+    Order target{};
+    target.id = clientOrderId;
+    target.ownerId = ownerId;
+    target.priceTick = newPrice;
+    target.quantity = newQty;
+    append(timestamp, EventType::ModifyClient, target);
+    return fills;
+}
+
+bool BookHistory::cancelByEngineId(uint64_t timestamp, uint64_t engineOrderId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool cancelled = book_.cancelByEngineId(engineOrderId);
+    Order target{};
+    target.id = engineOrderId;
+    append(timestamp, EventType::CancelEngine, target);
+    return cancelled;
+}
+
+std::vector<Fill> BookHistory::modifyByEngineId(uint64_t timestamp, uint64_t engineOrderId,
+                                                int64_t newPrice, uint32_t newQty) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Fill> fills = book_.modifyByEngineId(engineOrderId, newPrice, newQty);
+    Order target{};
+    target.id = engineOrderId;
+    target.priceTick = newPrice;
+    target.quantity = newQty;
+    append(timestamp, EventType::ModifyEngine, target);
+    return fills;
+}
+
+void BookHistory::setPosition(uint64_t timestamp, uint32_t ownerId, int64_t position) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    book_.setPosition(ownerId, position);
+    Order target{};
+    target.ownerId = ownerId;
+    target.priceTick = position;
+    append(timestamp, EventType::SetPosition, target);
+}
+
+void BookHistory::append(uint64_t timestamp, EventType type, const Order& order) {
+    events_.push_back({timestamp, type, order});
+
+    // The live book has already applied the event, so its image is the
+    // state after every journalled event so far
+    if (events_.size() - checkpoints_.back().eventIndex >= checkpointInterval_) {
+        checkpoints_.push_back({timestamp, events_.size(), book_.getOrderCount(), {}});
+        book_.writeSnapshot(checkpoints_.back().image);
+    }
+}
+
+void BookHistory::apply(OrderBook& book, const Event& event) {
+    const Order& o = event.order;
+    switch (event.type) {
+        case EventType::Submit:       book.submitOrder(o); break;
+        case EventType::CancelClient: book.cancelOrder(o.ownerId, o.id); break;
+        case EventType::ModifyClient: book.modifyOrder(o.ownerId, o.id, o.priceTick, o.quantity); break;
+        case EventType::CancelEngine: book.cancelByEngineId(o.id); break;
+        case EventType::ModifyEngine: book.modifyByEngineId(o.id, o.priceTick, o.quantity); break;
+        case EventType::SetPosition:  book.setPosition(o.ownerId, o.priceTick); break;
+    }
+}
+
+size_t BookHistory::checkpointFor(uint64_t timestamp) const {
+    // Latest checkpoint whose included events are all stamped <= timestamp
+    auto it = std::upper_bound(checkpoints_.begin() + 1, checkpoints_.end(), timestamp,
+        [](uint64_t t, const Checkpoint& c) { return t < c.timestamp; });
+    return static_cast<size_t>(it - checkpoints_.begin()) - 1;
+}
+
+void BookHistory::restoreCheckpoint(size_t index) {
+    const Checkpoint& checkpoint = checkpoints_[index];
+    replay_->loadSnapshot(checkpoint.image.data(), checkpoint.image.size());
+    replayPos_ = checkpoint.eventIndex;
+    replayCheckpoint_ = index;
+}
+
+void BookHistory::replayThrough(uint64_t timestamp) {
+    while (replayPos_ < events_.size() && events_[replayPos_].timestamp <= timestamp) {
+        apply(*replay_, events_[replayPos_++]);
+    }
+}
+
+void BookHistory::seek(uint64_t timestamp) {
+    size_t target = checkpointFor(timestamp);
+
+    // Keep replaying forward unless the replay book is already past
+    // timestamp, or restoring a later checkpoint (roughly one unit of work
+    // per resting order) is cheaper than replaying the events it skips
+    const Checkpoint& checkpoint = checkpoints_[target];
+    bool reusable = replayCheckpoint_ != SIZE_MAX &&
+                    (replayPos_ == 0 || events_[replayPos_ - 1].timestamp <= timestamp) &&
+                    (checkpoint.eventIndex <= replayPos_ ||
+                     checkpoint.eventIndex - replayPos_ <= checkpoint.orderCount);
+    if (!reusable) restoreCheckpoint(target);
+    replayThrough(timestamp);
+}
+
+const OrderBook& BookHistory::bookAt(uint64_t timestamp) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    seek(timestamp);
+    return *replay_;
+}
+
+std::vector<LevelInfo> BookHistory::topLevelsAt(uint64_t timestamp, Side side, size_t depth) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    seek(timestamp);
+    return replay_->getTopLevels(side, depth);
+}
+
+void BookHistory::topLevelsAt(const std::vector<Query>& queries,
+                              std::vector<std::vector<LevelInfo>>& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out.resize(queries.size());
+
+    std::vector<size_t> order(queries.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+        [&](size_t a, size_t b) { return queries[a].timestamp < queries[b].timestamp; });
+
+    for (size_t i : order) {
+        seek(queries[i].timestamp);
+        out[i] = replay_->getTopLevels(queries[i].side, queries[i].depth);
+    }
+}
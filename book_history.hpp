@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "orderbook.hpp"
+
+
+// Journal of book inputs with periodic in-memory checkpoints, for rebuilding
+// the book as of any recorded timestamp. Operations go through the recorder
+// so the live book and the journal stay in step; timestamps are supplied by
+// the caller and must be non-decreasing. Replay is deterministic because
+// engine order ids are restored with each checkpoint, so engine-id cancels
+// and modifies replay exactly.
+//
+// The recorder's mutex is held across applying an operation and journalling
+// it, so concurrent callers are journalled in the order the book saw them;
+// fill handlers must not call back into the recorder. Only input that goes
+// through the recorder is journalled: handle-based operations, and orders
+// that reach the book from a LiquidationEngine, a ComboCoordinator leg or
+// an implied-leg fill driven by another book, are not, and replays of a
+// book that takes them diverge from it.
+class BookHistory {
+public:
+    explicit BookHistory(OrderBook& book, size_t checkpointInterval = 100000,
+                         size_t replayCapacity = 65536);
+
+    // Recorded operations, applied to the live book
+    OrderHandle submitOrder(uint64_t timestamp, const Order& order, std::vector<Fill>* fills = nullptr);
+    bool cancelOrder(uint64_t timestamp, uint32_t ownerId, uint64_t clientOrderId);
+    std::vector<Fill> modifyOrder(uint64_t timestamp, uint32_t ownerId, uint64_t clientOrderId,
+                                  int64_t newPrice, uint32_t newQty);
+    bool cancelByEngineId(uint64_t timestamp, uint64_t engineOrderId);
+    std::vector<Fill> modifyByEngineId(uint64_t timestamp, uint64_t engineOrderId,
+                                       int64_t newPrice, uint32_t newQty);
+    void setPosition(uint64_t timestamp, uint32_t ownerId, int64_t position);
+
+    // Top-N levels of one side after every event stamped <= timestamp
+    struct Query {
+        uint64_t timestamp;
+        Side side;
+        size_t depth;
+    };
+    std::vector<LevelInfo> topLevelsAt(uint64_t timestamp, Side side, size_t depth);
+
+    // Answers queries in timestamp order with a single forward replay,
+    // jumping ahead to a later checkpoint only when it skips replay work.
+    // out[i] answers queries[i]; queries may be given in any order.
+    void topLevelsAt(const std::vector<Query>& queries, std::vector<std::vector<LevelInfo>>& out);
+
+    // Restore the replay book to its state at timestamp and return it; valid
+    // until the next query
+    const OrderBook& bookAt(uint64_t timestamp);
+
+    size_t eventCount() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return events_.size();
+    }
+    size_t checkpointCount() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return checkpoints_.size();
+    }
+
+private:
+    enum class EventType : uint8_t { Submit, CancelClient, ModifyClient, CancelEngine, ModifyEngine, SetPosition };
+
+    // Order carries every operand: id/ownerId name the target, priceTick
+    // and quantity are the new values for modifies, and priceTick is the
+    // position for SetPosition
+    struct Event {
+        uint64_t timestamp;
+        EventType type;
+        Order order;
+    };
+
+    struct Checkpoint {
+        uint64_t timestamp;       // stamp of the last event included
+        size_t eventIndex;        // first event not included
+        size_t orderCount;        // restore cost, in orders
+        std::vector<char> image;  // OrderBook snapshot
+    };
+
+    void append(uint64_t timestamp, EventType type, const Order& order);
+    void apply(OrderBook& book, const Event& event);
+
+    // Replay book positioning
+    size_t checkpointFor(uint64_t timestamp) const;
+    void restoreCheckpoint(size_t index);
+    void replayThrough(uint64_t timestamp);
+    void seek(uint64_t timestamp);
+
+    mutable std::mutex mutex_;            // serialises recording and replay
+    OrderBook& book_;
+    size_t checkpointInterval_;
+    std::vector<Event> events_;
+    std::vector<Checkpoint> checkpoints_;   // checkpoints_[0] is the initial book
+
+    std::unique_ptr<OrderBook> replay_;
+    size_t replayPos_ = 0;                  // next event to apply to replay_
+    size_t replayCheckpoint_ = SIZE_MAX;    // checkpoint replay_ was restored from
+};
@@ -0,0 +1,113 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+
+// Book-level locking strategies:
+//   None       - single owning thread, lock/unlock compile to a branch
+//   SpinLock   - test-and-test-and-set with exponential backoff
+//   TicketLock - FIFO-fair spinning, bounded waiting under contention
+//   Mutex      - std::mutex, sleeps in the kernel when contended
+// Both spinners fall back to yielding once backoff saturates, so a holder
+// preempted on an oversubscribed core can still make progress. Ticket locks
+// still convoy when threads outnumber cores; prefer them on pinned threads.
+enum class LockPolicy { None, SpinLock, TicketLock, Mutex };
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+class SpinLock {
+public:
+    void lock() {
+        uint32_t backoff = 1;
+        while (locked_.exchange(true, std::memory_order_acquire)) {
+            // Spin on a plain load so waiters share the line until release
+            do {
+                if (backoff < MAX_BACKOFF) {
+                    for (uint32_t i = 0; i < backoff; ++i) cpuRelax();
+                    backoff <<= 1;
+                } else {
+                    std::this_thread::yield();
+                }
+            } while (locked_.load(std::memory_order_relaxed));
+        }
+    }
+
+    void unlock() { locked_.store(false, std::memory_order_release); }
+
+private:
+    static constexpr uint32_t MAX_BACKOFF = 1024;
+    std::atomic<bool> locked_{false};
+};
+
+class TicketLock {
+public:
+    void lock() {
+        uint32_t ticket = next_.fetch_add(1, std::memory_order_relaxed);
+        for (uint32_t spins = 0;; ++spins) {
+            uint32_t serving = serving_.load(std::memory_order_acquire);
+            if (serving == ticket) return;
+            if (spins >= MAX_SPINS) {
+                std::this_thread::yield();
+                continue;
+            }
+            // Back off in proportion to our distance from the head of the queue
+            for (uint32_t i = 0, n = (ticket - serving) * 16; i < n; ++i) cpuRelax();
+        }
+    }
+
+    void unlock() {
+        serving_.store(serving_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    static constexpr uint32_t MAX_SPINS = 64;
+    std::atomic<uint32_t> next_{0};
+    std::atomic<uint32_t> serving_{0};
+};
+
+// Runtime-selected lock; the policy is fixed at construction so the switch
+// is perfectly predicted. Satisfies BasicLockable for std::lock_guard.
+class BookLock {
+public:
+    explicit BookLock(LockPolicy policy = LockPolicy::Mutex) : policy_(policy) {}
+
+    BookLock(const BookLock&) = delete;
+    BookLock& operator=(const BookLock&) = delete;
+
+    void lock() {
+        switch (policy_) {
+            case LockPolicy::None:       break;
+            case LockPolicy::SpinLock:   spin_.lock(); break;
+            case LockPolicy::TicketLock: ticket_.lock(); break;
+            case LockPolicy::Mutex:      mutex_.lock(); break;
+        }
+    }
+
+    void unlock() {
+        switch (policy_) {
+            case LockPolicy::None:       break;
+            case LockPolicy::SpinLock:   spin_.unlock(); break;
+            case LockPolicy::TicketLock: ticket_.unlock(); break;
+            case LockPolicy::Mutex:      mutex_.unlock(); break;
+        }
+    }
+
+    LockPolicy policy() const { return policy_; }
+
+private:
+    const LockPolicy policy_;
+    SpinLock spin_;
+    TicketLock ticket_;
+    std::mutex mutex_;
+};
@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+// Open-addressing hash keyed on (ownerId, clientOrderId). Linear probing with
+// backward-shift deletion, so there are no tombstones and lookups stay O(1)
+// under churn. Values are order pool slots; 16 bytes per entry.
+class ClientOrderIndex {
+public:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+    explicit ClientOrderIndex(size_t expected = 1024) {
+        size_t capacity = 16;
+        while (capacity < expected * 2) capacity <<= 1;
+        entries_.resize(capacity);
+        mask_ = capacity - 1;
+    }
+
+    uint32_t find(uint32_t ownerId, uint64_t clientOrderId) const {
+        for (size_t i = hash(ownerId, clientOrderId) & mask_;; i = (i + 1) & mask_) {
+            const Entry& e = entries_[i];
+            if (e.value == NOT_FOUND) return NOT_FOUND;
+            if (e.clientOrderId == clientOrderId && e.ownerId == ownerId) return e.value;
+        }
+    }
+
+    // Returns false (and leaves the index unchanged) if the key is present
+    bool insert(uint32_t ownerId, uint64_t clientOrderId, uint32_t value) {
+        if ((size_ + 1) * 2 > entries_.size()) grow();
+
+        size_t i = hash(ownerId, clientOrderId) & mask_;
+        for (;; i = (i + 1) & mask_) {
+            Entry& e = entries_[i];
+            if (e.value == NOT_FOUND) break;
+            if (e.clientOrderId == clientOrderId && e.ownerId == ownerId) return false;
+        }
+        entries_[i] = {clientOrderId, ownerId, value};
+        ++size_;
+        return true;
+    }
+
+    bool erase(uint32_t ownerId, uint64_t clientOrderId) {
+        size_t i = hash(ownerId, clientOrderId) & mask_;
+        for (;; i = (i + 1) & mask_) {
+            const Entry& e = entries_[i];
+            if (e.value == NOT_FOUND) return false;
+            if (e.clientOrderId == clientOrderId && e.ownerId == ownerId) break;
+        }
+
+        // Shift later members of the probe chain back into the hole
+        size_t hole = i;
+        for (size_t j = (i + 1) & mask_; entries_[j].value != NOT_FOUND; j = (j + 1) & mask_) {
+            size_t home = hash(entries_[j].ownerId, entries_[j].clientOrderId) & mask_;
+            if (((j - home) & mask_) >= ((j - hole) & mask_)) {
+                entries_[hole] = entries_[j];
+                hole = j;
+            }
+        }
+        entries_[hole] = Entry{};
+        --size_;
+        return true;
+    }
+
+    void clear() {
+        for (Entry& e : entries_) e = Entry{};
+        size_ = 0;
+    }
+
+    size_t size() const { return size_; }
+    size_t memoryBytes() const { return entries_.capacity() * sizeof(Entry); }
+
+private:
+    struct Entry {
+        uint64_t clientOrderId = 0;
+        uint32_t ownerId = 0;
+        uint32_t value = NOT_FOUND;
+    };
+
+    static size_t hash(uint32_t ownerId, uint64_t clientOrderId) {
+        uint64_t h = clientOrderId ^ (static_cast<uint64_t>(ownerId) << 32 | ownerId);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return static_cast<size_t>(h);
+    }
+
+    void grow() {
+        std::vector<Entry> old;
+        old.swap(entries_);
+        entries_.resize(old.size() * 2);
+        mask_ = entries_.size() - 1;
+        size_ = 0;
+        for (const Entry& e : old) {
+            if (e.value != NOT_FOUND) insert(e.ownerId, e.clientOrderId, e.value);
+        }
+    }
+
+    std::vector<Entry> entries_;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+};
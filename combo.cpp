@@ -0,0 +1,135 @@
+#include "combo.hpp"
+#include <algorithm>
+#include <functional>
+
+ComboResult ComboCoordinator::submit(const ComboOrder& combo, std::vector<Fill>* fills) {
+    ComboStatus status = validate(combo);
+    if (status != ComboStatus::Filled) return {status, 0};
+
+    size_t legCount = combo.legCount;
+    for (size_t i = 0; i < legCount; ++i) lockOrder_[i] = combo.legs[i].book;
+    std::sort(lockOrder_.begin(), lockOrder_.begin() + legCount, std::less<OrderBook*>());
+
+    std::array<OrderBook::FillDispatch, MAX_COMBO_LEGS> dispatch;
+    __int128 net = 0;
+    {
+        for (size_t i = 0; i < legCount; ++i) {
+            lockOrder_[i]->lock_.lock();
+            lockOrder_[i]->wakeLocked();
+        }
+
+        // Plan every leg from level aggregates before anything trades
+        for (size_t i = 0; i < legCount && status == ComboStatus::Filled; ++i) {
+            const ComboLeg& leg = combo.legs[i];
+            uint32_t quantity = leg.ratio * combo.quantity;
+            if (leg.book->clientIndex_.find(combo.ownerId, combo.id) != ClientOrderIndex::NOT_FOUND) {
+                status = ComboStatus::DuplicateClientOrderId;
+            } else if (!planLeg(*leg.book, leg.side, quantity, plans_[i])) {
+                status = ComboStatus::NotFillable;
+            } else {
+                net += leg.side == Side::Buy ? plans_[i].notional : -plans_[i].notional;
+            }
+        }
+        if (status == ComboStatus::Filled &&
+            net > static_cast<__int128>(combo.limitNetTick) * combo.quantity) {
+            status = ComboStatus::PriceNotMet;
+        }
+        for (size_t i = 0; i < legCount && status == ComboStatus::Filled; ++i) {
+            const ComboLeg& leg = combo.legs[i];
+            if (reachesOwnOrder(*leg.book, leg.side, leg.ratio * combo.quantity, combo.ownerId)) {
+                status = ComboStatus::SelfMatch;
+            }
+        }
+
+        // Execute; pegs inside the plan can only improve on it
+        if (status == ComboStatus::Filled) {
+            net = 0;
+            for (size_t i = 0; i < legCount; ++i) {
+                const ComboLeg& leg = combo.legs[i];
+                Order order{combo.id, leg.side, plans_[i].worstPriceTick, leg.ratio * combo.quantity,
+                            OrderType::Limit, TimeInForce::IOC, combo.ownerId, 0};
+                legFills_.clear();
+                leg.book->submitLocked(order, &legFills_);
+                for (const Fill& fill : legFills_) {
+                    __int128 notional = static_cast<__int128>(fill.priceTick) * fill.quantity;
+                    net += leg.side == Side::Buy ? notional : -notional;
+                }
+                if (fills) fills->insert(fills->end(), legFills_.begin(), legFills_.end());
+            }
+        }
+
+        for (size_t i = 0; i < legCount; ++i) lockOrder_[i]->stageFills(dispatch[i]);
+        for (size_t i = legCount; i-- > 0;) lockOrder_[i]->lock_.unlock();
+    }
+    for (size_t i = 0; i < legCount; ++i) OrderBook::dispatchFills(dispatch[i]);
+
+    if (status != ComboStatus::Filled) return {status, 0};
+    return {status, static_cast<int64_t>(net)};
+}
+
+ComboStatus ComboCoordinator::validate(const ComboOrder& combo) const {
+    if (combo.legCount == 0 || combo.legCount > MAX_COMBO_LEGS || combo.quantity == 0) {
+        return ComboStatus::InvalidCombo;
+    }
+    for (size_t i = 0; i < combo.legCount; ++i) {
+        const ComboLeg& leg = combo.legs[i];
+        // Implied matching locks other books from inside a leg's match
+        if (!leg.book || leg.book->implied_ || leg.ratio == 0 ||
+            static_cast<uint64_t>(leg.ratio) * combo.quantity > UINT32_MAX) {
+            return ComboStatus::InvalidCombo;
+        }
+        // A second leg on the same book would trade against the first's plan
+        for (size_t j = 0; j < i; ++j) {
+            if (combo.legs[j].book == leg.book) return ComboStatus::InvalidCombo;
+        }
+    }
+    return ComboStatus::Filled;
+}
+
+bool ComboCoordinator::planLeg(const OrderBook& book, Side side, uint32_t quantity, LegPlan& plan) {
+    uint64_t needed = quantity;
+    plan.notional = 0;
+
+    auto take = [&](int64_t priceTick, const OrderBook::PriceLevel& level) {
+        uint64_t qty = std::min<uint64_t>(needed, level.totalQuantity);
+        plan.notional += static_cast<__int128>(priceTick) * qty;
+        plan.worstPriceTick = priceTick;
+        needed -= qty;
+        return needed == 0;
+    };
+
+    if (side == Side::Buy) {
+        for (auto it = book.asks_.begin(); it != book.asks_.end(); ++it) {
+            if (take(it->first, it->second)) return true;
+        }
+    } else {
+        for (auto it = book.bids_.rbegin(); it != book.bids_.rend(); ++it) {
+            if (take(it->first, it->second)) return true;
+        }
+    }
+    return false;
+}
+
+bool ComboCoordinator::reachesOwnOrder(const OrderBook& book, Side side, uint32_t quantity, uint32_t ownerId) {
+    // Walk the planned sweep in priority order, as matchLevel would
+    uint64_t needed = quantity;
+    auto walk = [&](const OrderBook::PriceLevel& level) {
+        for (uint32_t slot = level.head; slot != INVALID_SLOT && needed > 0; slot = book.pool_[slot].next) {
+            const auto& order = book.pool_[slot];
+            if (order.ownerId == ownerId) return true;
+            needed -= std::min<uint64_t>(needed, order.quantity);
+        }
+        return false;
+    };
+
+    if (side == Side::Buy) {
+        for (auto it = book.asks_.begin(); it != book.asks_.end() && needed > 0; ++it) {
+            if (walk(it->second)) return true;
+        }
+    } else {
+        for (auto it = book.bids_.rbegin(); it != book.bids_.rend() && needed > 0; ++it) {
+            if (walk(it->second)) return true;
+        }
+    }
+    return false;
+}
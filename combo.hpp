@@ -0,0 +1,75 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "orderbook.hpp"
+
+
+static constexpr size_t MAX_COMBO_LEGS = 4;
+
+// One leg per book; the leg trades ratio * combo quantity
+struct ComboLeg {
+    OrderBook* book;
+    Side       side;
+    uint32_t   ratio;
+};
+
+// Net price is per combo unit: sum over legs of ratio * price, bought legs
+// positive and sold legs negative. limitNetTick caps it, so a negative
+// limit means the combo must be entered for a credit.
+struct ComboOrder {
+    uint64_t   id;              // client order id, reused on every leg
+    uint32_t   ownerId;
+    uint32_t   quantity;        // combo units
+    int64_t    limitNetTick;
+    uint32_t   legCount;
+    std::array<ComboLeg, MAX_COMBO_LEGS> legs;
+};
+
+enum class ComboStatus : uint8_t {
+    Filled,
+    InvalidCombo,      // no legs, too many, a repeated or implied-linked book, zero ratio or quantity
+    NotFillable,       // a leg lacks displayed depth
+    PriceNotMet,       // the combined sweep is worse than limitNetTick
+    SelfMatch,         // a leg would reach the owner's own resting order
+    DuplicateClientOrderId
+};
+
+struct ComboResult {
+    ComboStatus status;
+    int64_t     netNotional;    // sum of ratio-weighted leg notionals, ticks * qty
+};
+
+// All-or-none execution of a combo across separate books. The leg books are
+// locked in address order, so coordinators never deadlock with each other
+// and single-book callers only ever wait on one combined match. Each leg is
+// planned from level aggregates on the contra ladder; the plan is exact
+// under the locks because resting pegs can only add liquidity at or inside
+// it, and the one thing that can stop a sweep short (the owner's own order
+// at the head of a level) is checked on the levels the plan touches once
+// every leg and the net price have passed, so rejections stay cheap. Legs
+// then execute as IOC limits at their planned worst price and report as
+// ordinary orders in their own books. Fills are dispatched after every lock
+// is released.
+//
+// A coordinator keeps scratch buffers; use one per submitting thread.
+class ComboCoordinator {
+public:
+    ComboResult submit(const ComboOrder& combo, std::vector<Fill>* fills = nullptr);
+
+private:
+    struct LegPlan {
+        int64_t  worstPriceTick;
+        __int128 notional;
+    };
+
+    ComboStatus validate(const ComboOrder& combo) const;
+    static bool planLeg(const OrderBook& book, Side side, uint32_t quantity, LegPlan& plan);
+    static bool reachesOwnOrder(const OrderBook& book, Side side, uint32_t quantity, uint32_t ownerId);
+
+    // Scratch reused between calls
+    std::array<OrderBook*, MAX_COMBO_LEGS> lockOrder_{};
+    std::array<LegPlan, MAX_COMBO_LEGS> plans_{};
+    std::vector<Fill> legFills_;
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+
+
+// std::allocator that adds every allocation to an external byte counter, so
+// node-based containers can report what they hold: nodes, bucket arrays and
+// padding, but not the heap's own per-block overhead. Rebound copies share
+// the counter. The counter is a plain size_t and is updated by whichever
+// thread mutates the container, so it is guarded by that container's lock.
+template <typename T>
+class CountingAllocator {
+public:
+    using value_type = T;
+
+    explicit CountingAllocator(size_t* bytes) : bytes_(bytes) {}
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>& other) : bytes_(other.bytes_) {}
+
+    T* allocate(size_t n) {
+        *bytes_ += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) {
+        *bytes_ -= n * sizeof(T);
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U>& other) const { return bytes_ == other.bytes_; }
+    template <typename U>
+    bool operator!=(const CountingAllocator<U>& other) const { return bytes_ != other.bytes_; }
+
+private:
+    template <typename> friend class CountingAllocator;
+    size_t* bytes_;
+};
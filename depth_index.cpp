@@ -0,0 +1,102 @@
+#include "depth_index.hpp"
+#include "orderbook.hpp"
+
+void DepthIndex::configure(int64_t baseTick, size_t numTicks) {
+    baseTick_ = baseTick;
+    numTicks_ = numTicks;
+    topStep_ = 0;
+    if (numTicks_ > 0) {
+        topStep_ = 1;
+        while (topStep_ * 2 <= numTicks_) topStep_ <<= 1;
+    }
+    for (int s = 0; s < 2; ++s) {
+        qty_[s].assign(numTicks_ + 1, 0);
+        weighted_[s].assign(numTicks_ + 1, 0);
+    }
+    total_[0] = total_[1] = 0;
+    outside_[0] = outside_[1] = 0;
+}
+
+void DepthIndex::clear() {
+    configure(baseTick_, numTicks_);
+}
+
+size_t DepthIndex::index(Side side) {
+    return side == Side::Buy ? 0 : 1;
+}
+
+size_t DepthIndex::position(Side side, int64_t priceTick) const {
+    return side == Side::Buy
+        ? static_cast<size_t>(baseTick_ + static_cast<int64_t>(numTicks_) - 1 - priceTick)
+        : static_cast<size_t>(priceTick - baseTick_);
+}
+
+int64_t DepthIndex::priceAt(Side side, size_t position) const {
+    return side == Side::Buy
+        ? baseTick_ + static_cast<int64_t>(numTicks_) - 1 - static_cast<int64_t>(position)
+        : baseTick_ + static_cast<int64_t>(position);
+}
+
+void DepthIndex::add(Side side, int64_t priceTick, int64_t delta) {
+    size_t s = index(side);
+    if (!inWindow(priceTick)) {
+        outside_[s] += static_cast<uint64_t>(delta);
+        return;
+    }
+
+    size_t pos = position(side, priceTick);
+    uint64_t dq = static_cast<uint64_t>(delta);
+    uint64_t dw = static_cast<uint64_t>(delta * static_cast<int64_t>(pos));
+
+    // Unsigned wrap-around makes negative deltas subtract correctly
+    for (size_t i = pos + 1; i <= numTicks_; i += i & (~i + 1)) {
+        qty_[s][i] += dq;
+        weighted_[s][i] += dw;
+    }
+    total_[s] += dq;
+}
+
+uint64_t DepthIndex::depthThrough(Side side, int64_t priceTick) const {
+    size_t s = index(side);
+
+    // Clamp to the window: nearer than the window is empty, beyond it is everything
+    int64_t offset = side == Side::Buy
+        ? baseTick_ + static_cast<int64_t>(numTicks_) - 1 - priceTick
+        : priceTick - baseTick_;
+    if (offset < 0) return 0;
+    if (offset >= static_cast<int64_t>(numTicks_)) return total_[s];
+
+    uint64_t sum = 0;
+    for (size_t i = static_cast<size_t>(offset) + 1; i > 0; i -= i & (~i + 1)) {
+        sum += qty_[s][i];
+    }
+    return sum;
+}
+
+DepthIndex::Sweep DepthIndex::sweep(Side side, uint64_t quantity) const {
+    size_t s = index(side);
+    uint64_t target = quantity < total_[s] ? quantity : total_[s];
+    if (target == 0) return {0, 0, 0};
+
+    // Binary lifting: largest prefix whose quantity stays below target
+    size_t pos = 0;
+    uint64_t accQty = 0, accWeighted = 0;
+    for (size_t step = topStep_; step > 0; step >>= 1) {
+        size_t next = pos + step;
+        if (next <= numTicks_ && accQty + qty_[s][next] < target) {
+            pos = next;
+            accQty += qty_[s][next];
+            accWeighted += weighted_[s][next];
+        }
+    }
+
+    // pos is now the 0-based position of the level where target is reached.
+    // Full levels before it: sum(price * q) = anchor * Q -/+ sum(q * position)
+    int64_t worst = priceAt(side, pos);
+    __int128 notional = side == Side::Buy
+        ? (__int128)priceAt(side, 0) * accQty - (__int128)accWeighted
+        : (__int128)priceAt(side, 0) * accQty + (__int128)accWeighted;
+    notional += (__int128)worst * (target - accQty);
+
+    return {target, notional, worst};
+}
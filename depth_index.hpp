@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+enum class Side;
+
+
+// Fenwick trees over a fixed window of price ticks, one pair per book side.
+// Positions run outward from the best price the window can hold (highest
+// tick for bids, lowest for asks), so a prefix sum is cumulative depth from
+// the touch. Each side keeps per-position quantity and quantity * position,
+// which is enough to price a sweep without visiting individual levels.
+// Quantity resting outside the window is only counted; callers must fall
+// back to the ladder while outsideQuantity() is non-zero.
+class DepthIndex {
+public:
+    struct Sweep {
+        uint64_t quantity;        // quantity reached, <= requested
+        __int128 notional;        // sum of priceTick * quantity
+        int64_t  worstPriceTick;  // furthest level touched (valid if quantity > 0)
+    };
+
+    void configure(int64_t baseTick, size_t numTicks);
+    void clear();
+
+    bool enabled() const { return numTicks_ > 0; }
+    bool inWindow(int64_t priceTick) const {
+        return priceTick >= baseTick_ && priceTick < baseTick_ + static_cast<int64_t>(numTicks_);
+    }
+
+    // O(log n) per level change
+    void add(Side side, int64_t priceTick, int64_t delta);
+
+    uint64_t outsideQuantity(Side side) const { return outside_[index(side)]; }
+    uint64_t totalQuantity(Side side) const { return total_[index(side)]; }
+    size_t memoryBytes() const {
+        return (qty_[0].capacity() + qty_[1].capacity() + weighted_[0].capacity() + weighted_[1].capacity()) *
+               sizeof(uint64_t);
+    }
+
+    // Quantity from the touch through priceTick inclusive (clamped to the window)
+    uint64_t depthThrough(Side side, int64_t priceTick) const;
+
+    // Walk outward from the touch until quantity is reached or the side is exhausted
+    Sweep sweep(Side side, uint64_t quantity) const;
+
+private:
+    static size_t index(Side side);
+    size_t position(Side side, int64_t priceTick) const;
+    int64_t priceAt(Side side, size_t position) const;
+
+    int64_t baseTick_ = 0;
+    size_t numTicks_ = 0;
+    size_t topStep_ = 0;                   // highest power of two <= numTicks_
+    std::vector<uint64_t> qty_[2];         // 1-based Fenwick arrays
+    std::vector<uint64_t> weighted_[2];    // quantity * position
+    uint64_t total_[2] = {0, 0};
+    uint64_t outside_[2] = {0, 0};
+};
@@ -0,0 +1,96 @@
+#include "fee_engine.hpp"
+#include <algorithm>
+
+namespace {
+    const FeeEngine::Account EMPTY_ACCOUNT{};
+}
+
+FeeEngine::FeeEngine(std::vector<FeeTier> defaultSchedule) {
+    addSchedule(std::move(defaultSchedule));
+}
+
+uint32_t FeeEngine::addSchedule(std::vector<FeeTier> tiers) {
+    if (tiers.empty()) tiers.push_back({0, 0, 0});
+    tiers.front().minVolume = 0;
+    schedules_.push_back(std::move(tiers));
+    return static_cast<uint32_t>(schedules_.size() - 1);
+}
+
+void FeeEngine::setSchedule(uint32_t ownerId, uint32_t scheduleId) {
+    OwnerState& s = state(ownerId);
+    s.scheduleId = scheduleId < schedules_.size() ? scheduleId : 0;
+    resolveTier(s);
+}
+
+int64_t FeeEngine::charge(uint32_t ownerId, Side side, Liquidity role,
+                          int64_t priceTick, uint32_t quantity, uint64_t timestamp) {
+    OwnerState& s = state(ownerId);
+    if (UNLIKELY(timestamp >= s.dayEndNs)) rollDays(s, timestamp);
+
+    // Rate from the tier in force before this fill's volume is added
+    int64_t notional = priceTick * static_cast<int64_t>(quantity);
+    int32_t rate = role == Liquidity::Maker ? s.makerRate : s.takerRate;
+    int64_t fee = HFTUtils::divideRounded((__int128)notional * rate, RATE_PRECISION, Rounding::Up);
+
+    uint64_t volume = static_cast<uint64_t>(notional < 0 ? -notional : notional);
+    s.buckets[s.day % WINDOW_DAYS] += volume;
+    s.account.volume30d += volume;
+    (role == Liquidity::Maker ? s.account.makerVolume : s.account.takerVolume) += volume;
+    s.account.fees += fee;
+    if (side == Side::Buy) {
+        s.account.cash -= notional;
+        s.account.position += quantity;
+    } else {
+        s.account.cash += notional;
+        s.account.position -= quantity;
+    }
+
+    if (UNLIKELY(s.account.volume30d >= s.tierHigh)) resolveTier(s);
+    return fee;
+}
+
+void FeeEngine::rollDays(OwnerState& s, uint64_t timestamp) {
+    uint64_t day = timestamp / DAY_NS;
+    if (s.dayEndNs != 0) {
+        // Expire the buckets of every day the window has moved past
+        uint64_t elapsed = std::min<uint64_t>(day - s.day, WINDOW_DAYS);
+        for (uint64_t i = 1; i <= elapsed; ++i) {
+            uint64_t& bucket = s.buckets[(s.day + i) % WINDOW_DAYS];
+            s.account.volume30d -= bucket;
+            bucket = 0;
+        }
+    }
+    s.day = day;
+    s.dayEndNs = (day + 1) * DAY_NS;
+
+    if (s.account.volume30d < s.tierLow || s.account.volume30d >= s.tierHigh) resolveTier(s);
+}
+
+void FeeEngine::resolveTier(OwnerState& s) {
+    const std::vector<FeeTier>& tiers = schedules_[s.scheduleId];
+    auto it = std::upper_bound(tiers.begin(), tiers.end(), s.account.volume30d,
+        [](uint64_t volume, const FeeTier& tier) { return volume < tier.minVolume; });
+    const FeeTier& tier = *(it - 1);
+
+    s.makerRate = tier.makerRate;
+    s.takerRate = tier.takerRate;
+    s.tierLow = tier.minVolume;
+    s.tierHigh = it == tiers.end() ? UINT64_MAX : it->minVolume;
+}
+
+FeeEngine::OwnerState& FeeEngine::state(uint32_t ownerId) {
+    if (OwnerState* s = owners_.find(ownerId)) return *s;
+    OwnerState& s = owners_.at(ownerId);
+    resolveTier(s);
+    return s;
+}
+
+const FeeEngine::Account& FeeEngine::account(uint32_t ownerId) const {
+    const OwnerState* s = owners_.find(ownerId);
+    return s ? s->account : EMPTY_ACCOUNT;
+}
+
+int64_t FeeEngine::pnl(uint32_t ownerId, int64_t markPriceTick) const {
+    const Account& a = account(ownerId);
+    return a.cash + a.position * markPriceTick - a.fees;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "orderbook.hpp"
+#include "owner_table.hpp"
+
+
+// One step of a fee schedule. Rates are in millionths of notional (1000 is
+// 10 bps); negative rates are rebates. Volume is notional (priceTick * qty).
+struct FeeTier {
+    uint64_t minVolume;
+    int32_t  makerRate;
+    int32_t  takerRate;
+};
+
+// Tiered maker/taker fees on rolling 30-day volume, plus per-owner cash and
+// position so PnL can be reported net of fees. Each owner caches its current
+// tier rates and the volume band that keeps them valid, so a fill costs an
+// owner lookup, a day-boundary compare, a band compare and a 128-bit
+// multiply; the tier is only re-resolved when volume leaves the band or a
+// day rolls off the window. Fees round up, so rebates round toward zero.
+//
+// Not thread-safe. Owners are hashed by id, so ids need not be dense.
+class FeeEngine {
+public:
+    static constexpr int64_t RATE_PRECISION = 1000000;
+    static constexpr size_t WINDOW_DAYS = 30;
+    static constexpr uint64_t DAY_NS = 86400ULL * 1000000000ULL;
+
+    // Per-owner running totals, notional units
+    struct Account {
+        uint64_t volume30d = 0;
+        uint64_t makerVolume = 0;
+        uint64_t takerVolume = 0;
+        int64_t  fees = 0;          // net of rebates
+        int64_t  cash = 0;          // sells minus buys
+        int64_t  position = 0;      // signed quantity
+    };
+
+    // Schedule 0 applies to owners without an explicit assignment
+    explicit FeeEngine(std::vector<FeeTier> defaultSchedule = {{0, 0, 0}});
+
+    // Tiers are sorted by minVolume; the first tier starts at volume 0
+    uint32_t addSchedule(std::vector<FeeTier> tiers);
+    void setSchedule(uint32_t ownerId, uint32_t scheduleId);
+
+    // Books the fill for ownerId and returns its fee
+    int64_t charge(uint32_t ownerId, Side side, Liquidity role,
+                   int64_t priceTick, uint32_t quantity, uint64_t timestamp);
+
+    const Account& account(uint32_t ownerId) const;
+    int64_t pnl(uint32_t ownerId, int64_t markPriceTick) const;
+
+private:
+    struct OwnerState {
+        uint32_t scheduleId = 0;
+        int32_t makerRate = 0;
+        int32_t takerRate = 0;
+        uint64_t tierLow = 0;               // rates valid for tierLow <= volume30d < tierHigh
+        uint64_t tierHigh = 0;              // 0 until resolved
+        uint64_t dayEndNs = 0;              // end of the current bucket's day
+        uint64_t day = 0;
+        std::array<uint64_t, WINDOW_DAYS> buckets{};
+        Account account;
+    };
+
+    OwnerState& state(uint32_t ownerId);
+    void rollDays(OwnerState& s, uint64_t timestamp);
+    void resolveTier(OwnerState& s);
+
+    std::vector<std::vector<FeeTier>> schedules_;
+    OwnerTable<OwnerState> owners_;
+};
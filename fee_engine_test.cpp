@@ -0,0 +1,73 @@
+// Checks for FeeEngine: sparse owner ids, fee rounding and notionals whose
+// fee product does not fit 64 bits. Exits non-zero on the first failure.
+// Build against the library sources, for example:
+//   g++ -std=c++17 -O2 fee_engine_test.cpp fee_engine.cpp orderbook.cpp
+//       implied.cpp depth_index.cpp logger.cpp -o fee_engine_test -lpthread
+#include "fee_engine.hpp"
+#include "orderbook.hpp"
+#include <cinttypes>
+#include <cstdio>
+#include <vector>
+
+namespace {
+    int failures = 0;
+
+    void expect(bool ok, const char* what, int64_t got, int64_t want) {
+        if (ok) return;
+        std::fprintf(stderr, "FAIL %s: got %" PRId64 ", want %" PRId64 "\n", what, got, want);
+        ++failures;
+    }
+
+    void expectEq(const char* what, int64_t got, int64_t want) { expect(got == want, what, got, want); }
+
+    // A maker and a taker near the top of the id range trade through a
+    // book; neither id may cost more than its own table entry
+    void largeOwnerIds() {
+        constexpr uint32_t MAKER = UINT32_MAX - 2;
+        constexpr uint32_t TAKER = UINT32_MAX - 1;   // UINT32_MAX is the implied owner
+        FeeEngine fees({{0, -100, 500}});
+        OrderBook book(64, LockPolicy::None);
+        book.setFeeEngine(&fees);
+
+        std::vector<Fill> fills;
+        book.submitOrder({1, Side::Sell, 10000, 100, OrderType::Limit, TimeInForce::GTC, MAKER, 0});
+        book.submitOrder({1, Side::Buy, 10000, 100, OrderType::Limit, TimeInForce::IOC, TAKER, 0}, &fills);
+
+        expectEq("large-id fill count", int64_t(fills.size()), 1);
+        if (fills.size() != 1) return;
+        // Notional 1,000,000: taker pays 5 bps, maker earns 1 bp
+        expectEq("large-id taker fee", fills[0].takerFee, 500);
+        expectEq("large-id maker fee", fills[0].makerFee, -100);
+        expectEq("large-id taker account", fees.account(TAKER).fees, 500);
+        expectEq("large-id maker account", fees.account(MAKER).fees, -100);
+        expectEq("large-id maker position", fees.account(MAKER).position, -100);
+        expectEq("unseen owner fees", fees.account(12345).fees, 0);
+    }
+
+    void rounding() {
+        FeeEngine fees({{0, -1000, 1000}});
+        // Notional 1001 at 10 bps is 1.001: fees round up, rebates toward zero
+        expectEq("fee rounds up", fees.charge(1, Side::Buy, Liquidity::Taker, 1001, 1, 0), 2);
+        expectEq("rebate rounds toward zero", fees.charge(2, Side::Sell, Liquidity::Maker, 1001, 1, 0), -1);
+        expectEq("exact fee", fees.charge(3, Side::Buy, Liquidity::Taker, 1000, 1, 0), 1);
+    }
+
+    // Notional 1e18 fits 64 bits; notional * rate does not
+    void wideNotional() {
+        FeeEngine fees({{0, -250, 1000}});
+        int64_t taker = fees.charge(7, Side::Buy, Liquidity::Taker, 1000000000000LL, 1000000, 0);
+        int64_t maker = fees.charge(8, Side::Sell, Liquidity::Maker, 1000000000000LL, 1000000, 0);
+        expectEq("wide taker fee", taker, 1000000000000000LL);
+        expectEq("wide maker rebate", maker, -250000000000000LL);
+        expectEq("wide taker pnl", fees.pnl(7, 1000000000000LL), -1000000000000000LL);
+    }
+}
+
+int main() {
+    largeOwnerIds();
+    rounding();
+    wideNotional();
+    if (failures) return 1;
+    std::printf("fee_engine_test: ok\n");
+    return 0;
+}
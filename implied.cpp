@@ -0,0 +1,119 @@
+#include "implied.hpp"
+#include <algorithm>
+#include <functional>
+#include <mutex>
+
+namespace {
+    constexpr uint8_t SPREAD = 0;
+    constexpr uint8_t FRONT = 1;
+    constexpr uint8_t BACK = 2;
+}
+
+// [book][implied side, 0 = bid][leg]; an implied bid is hit by a seller, so
+// its legs sell the contributing bids or buy the contributing asks
+const ImpliedEngine::LegRef ImpliedEngine::LEGS[BOOKS][2][2] = {
+    {{{FRONT, Side::Sell, 1}, {BACK, Side::Buy, -1}},
+     {{FRONT, Side::Buy, 1},  {BACK, Side::Sell, -1}}},
+    {{{SPREAD, Side::Sell, 1}, {BACK, Side::Sell, 1}},
+     {{SPREAD, Side::Buy, 1},  {BACK, Side::Buy, 1}}},
+    {{{FRONT, Side::Sell, 1}, {SPREAD, Side::Buy, -1}},
+     {{FRONT, Side::Buy, 1},  {SPREAD, Side::Sell, -1}}},
+};
+
+ImpliedEngine::ImpliedEngine(OrderBook& spread, OrderBook& front, OrderBook& back)
+    : books_{{&spread, &front, &back}} {
+    for (OrderBook* book : books_) {
+        std::lock_guard<BookLock> lock(book->lock_);
+        book->implied_ = this;
+    }
+}
+
+ImpliedEngine::~ImpliedEngine() {
+    for (OrderBook* book : books_) {
+        std::lock_guard<BookLock> lock(book->lock_);
+        if (book->implied_ == this) book->implied_ = nullptr;
+    }
+}
+
+TopOfBook ImpliedEngine::impliedTop(const OrderBook& book) {
+    size_t index = indexOf(book);
+    refresh(index);
+    const auto& quotes = state_[index].quotes;
+    return {{quotes[0].priceTick, quotes[0].quantity, 0, quotes[0].quantity != 0},
+            {quotes[1].priceTick, quotes[1].quantity, 0, quotes[1].quantity != 0}};
+}
+
+bool ImpliedEngine::quote(const OrderBook& book, Side side, int64_t& priceTick, uint32_t& quantity) {
+    size_t index = indexOf(book);
+    refresh(index);
+    const Quote& q = state_[index].quotes[side == Side::Buy ? 0 : 1];
+    priceTick = q.priceTick;
+    quantity = q.quantity;
+    return quantity != 0;
+}
+
+uint32_t ImpliedEngine::execute(const OrderBook& book, Side side, uint32_t quantity) {
+    size_t index = indexOf(book);
+    refresh(index);
+    const auto& legs = LEGS[index][side == Side::Buy ? 0 : 1];
+    quantity = std::min(quantity, state_[index].quotes[side == Side::Buy ? 0 : 1].quantity);
+    if (quantity == 0) return 0;
+
+    // Both touches hold at least quantity and the implied taker never
+    // self-matches, so each leg fills exactly quantity
+    for (const LegRef& leg : legs) {
+        OrderBook& contributor = *books_[leg.book];
+        std::lock_guard<BookLock> lock(contributor.lock_);
+        contributor.fillImpliedLeg(leg.takerSide, quantity);
+
+        // Delivered by the aggressed book once its own lock is released
+        if (!contributor.pendingFills_.empty()) {
+            staged_.emplace_back();
+            staged_.back().handler = contributor.fillCb_;
+            staged_.back().fills.swap(contributor.pendingFills_);
+        }
+    }
+    return quantity;
+}
+
+void ImpliedEngine::takeStaged(std::vector<OrderBook::FillDispatch>& out) {
+    for (auto& dispatch : staged_) out.push_back(std::move(dispatch));
+    staged_.clear();
+}
+
+size_t ImpliedEngine::indexOf(const OrderBook& book) const {
+    return &book == books_[SPREAD] ? SPREAD : &book == books_[FRONT] ? FRONT : BACK;
+}
+
+void ImpliedEngine::refresh(size_t index) {
+    BookState& state = state_[index];
+    const auto& legs = LEGS[index][0];
+    OrderBook& first = *books_[legs[0].book];
+    OrderBook& second = *books_[legs[1].book];
+
+    // Both contributors share one lock order with every other caller
+    OrderBook* lo = std::min(&first, &second, std::less<OrderBook*>());
+    OrderBook* hi = lo == &first ? &second : &first;
+    std::lock_guard<BookLock> lockLo(lo->lock_);
+    std::lock_guard<BookLock> lockHi(hi->lock_);
+
+    if (first.topVersion_ == state.seenVersions[0] && second.topVersion_ == state.seenVersions[1]) return;
+    state.seenVersions = {{first.topVersion_, second.topVersion_}};
+
+    for (size_t s = 0; s < 2; ++s) {
+        int64_t priceTick = 0;
+        uint64_t quantity = UINT32_MAX;
+        for (const LegRef& leg : LEGS[index][s]) {
+            const OrderBook& contributor = *books_[leg.book];
+            const auto& levels = leg.takerSide == Side::Buy ? contributor.asks_ : contributor.bids_;
+            if (levels.empty()) {
+                quantity = 0;
+                break;
+            }
+            const auto& top = leg.takerSide == Side::Buy ? *levels.begin() : *levels.rbegin();
+            priceTick += leg.sign * top.first;
+            quantity = std::min(quantity, top.second.totalQuantity);
+        }
+        state.quotes[s] = {priceTick, static_cast<uint32_t>(quantity)};
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "orderbook.hpp"
+
+
+// First-generation implied prices for a 1:1 spread (front minus back) and
+// its two outright books:
+//   implied in,  spread:  bid = front.bid - back.ask   ask = front.ask - back.bid
+//   implied out, front:   bid = spread.bid + back.bid  ask = spread.ask + back.ask
+//   implied out, back:    bid = front.bid - spread.ask ask = front.ask - spread.bid
+// Each implied level is sized by the smaller of the two displayed touches it
+// is built from. A book's implied quotes are recomputed only when the top
+// version of one of its two contributing books has moved.
+//
+// Implied liquidity is matched from OrderBook::matchLoop like a resting
+// level: after displayed orders and pegs at the same price. A fill against
+// it trades the contributing touches with IMPLIED_OWNER_ID as the taker, so
+// every resting order is filled in its own book and the aggressor in its
+// own; the aggressor's fill names IMPLIED_OWNER_ID as the maker. Implied
+// prices are never uncrossed against resting orders, only aggressed.
+//
+// The three books are locked from inside each other's matching, so they
+// must all be driven from one thread; a book joins at most one engine.
+class ImpliedEngine {
+public:
+    ImpliedEngine(OrderBook& spread, OrderBook& front, OrderBook& back);
+    ~ImpliedEngine();
+
+    ImpliedEngine(const ImpliedEngine&) = delete;
+    ImpliedEngine& operator=(const ImpliedEngine&) = delete;
+
+    // Current implied touch for one of the three books; levels report count 0
+    TopOfBook impliedTop(const OrderBook& book);
+
+private:
+    friend class OrderBook;
+
+    static constexpr size_t BOOKS = 3;   // spread, front, back
+
+    // One contributing touch: the side an implied taker trades in that book
+    struct LegRef {
+        uint8_t book;
+        Side    takerSide;
+        int8_t  sign;
+    };
+
+    struct Quote {
+        int64_t  priceTick = 0;
+        uint32_t quantity = 0;
+    };
+
+    struct BookState {
+        std::array<uint64_t, 2> seenVersions{{UINT64_MAX, UINT64_MAX}};
+        std::array<Quote, 2> quotes{};      // by implied side, 0 = bid
+    };
+
+    static const LegRef LEGS[BOOKS][2][2];
+
+    // Called from the aggressed book's matching with its lock held
+    bool quote(const OrderBook& book, Side side, int64_t& priceTick, uint32_t& quantity);
+    uint32_t execute(const OrderBook& book, Side side, uint32_t quantity);
+    void takeStaged(std::vector<OrderBook::FillDispatch>& out);
+
+    size_t indexOf(const OrderBook& book) const;
+    void refresh(size_t index);
+
+    std::array<OrderBook*, BOOKS> books_;
+    std::array<BookState, BOOKS> state_;
+    std::vector<OrderBook::FillDispatch> staged_;   // contributors' fills awaiting dispatch
+};
@@ -0,0 +1,108 @@
+#include "liquidation.hpp"
+#include <algorithm>
+
+namespace {
+    const LiquidationEngine::Account EMPTY_ACCOUNT{};
+}
+
+LiquidationEngine::LiquidationEngine(OrderBook& book, int32_t maintenanceRate, int64_t slippageTicks)
+    : book_(book), maintenanceRate_(maintenanceRate), slippageTicks_(slippageTicks) {}
+
+void LiquidationEngine::setAccount(uint32_t ownerId, const Account& account) {
+    AccountState& s = state(ownerId);
+    unindex(s);
+    s.account = account;
+    index(ownerId);
+}
+
+const LiquidationEngine::Account& LiquidationEngine::account(uint32_t ownerId) const {
+    const AccountState* s = accounts_.find(ownerId);
+    return s ? s->account : EMPTY_ACCOUNT;
+}
+
+int64_t LiquidationEngine::triggerPrice(uint32_t ownerId) const {
+    const AccountState* s = accounts_.find(ownerId);
+    if (s && s->indexed) return s->trigger->first;
+    return account(ownerId).position < 0 ? INT64_MAX : INT64_MIN;
+}
+
+size_t LiquidationEngine::onMarkPrice(int64_t markPriceTick) {
+    // Collect first: liquidating re-indexes partial closes. Most underwater
+    // first, so the highest long triggers and the lowest short triggers.
+    triggered_.clear();
+    for (auto it = longs_.end(); it != longs_.begin();) {
+        --it;
+        if (it->first < markPriceTick) break;
+        triggered_.push_back(it->second);
+    }
+    for (auto it = shorts_.begin(); it != shorts_.end() && it->first <= markPriceTick; ++it) {
+        triggered_.push_back(it->second);
+    }
+
+    for (uint32_t ownerId : triggered_) liquidate(ownerId, markPriceTick);
+    return triggered_.size();
+}
+
+void LiquidationEngine::liquidate(uint32_t ownerId, int64_t markPriceTick) {
+    AccountState& s = state(ownerId);
+    unindex(s);
+    Account& a = s.account;
+
+    bool isLong = a.position > 0;
+    Side side = isLong ? Side::Sell : Side::Buy;
+    uint64_t size = static_cast<uint64_t>(isLong ? a.position : -a.position);
+    uint32_t quantity = static_cast<uint32_t>(std::min<uint64_t>(size, UINT32_MAX));
+    int64_t limit = isLong ? markPriceTick - slippageTicks_ : markPriceTick + slippageTicks_;
+
+    fills_.clear();
+    book_.submitOrder({nextClientId_++, side, limit, quantity, OrderType::Limit, TimeInForce::IOC, ownerId, 0},
+                      &fills_);
+    stats_.liquidations++;
+
+    // Realise PnL on what closed
+    for (const Fill& fill : fills_) {
+        int64_t closed = fill.quantity;
+        a.collateral += (isLong ? closed : -closed) * (fill.priceTick - a.entryPriceTick);
+        a.position += isLong ? -closed : closed;
+        stats_.quantity += fill.quantity;
+    }
+
+    if (a.position != 0) {
+        index(ownerId);
+    } else if (a.collateral < 0) {
+        stats_.badDebt -= a.collateral;
+        a.collateral = 0;
+    }
+}
+
+void LiquidationEngine::index(uint32_t ownerId) {
+    AccountState& s = state(ownerId);
+    const Account& a = s.account;
+    if (a.position == 0) return;
+
+    __int128 qty = a.position > 0 ? a.position : -static_cast<__int128>(a.position);
+    if (a.position > 0) {
+        // Underwater below (qty * entry - collateral) / (qty * (1 - m)); a
+        // long collateralised past its notional never is
+        __int128 num = (qty * a.entryPriceTick - a.collateral) * RATE_PRECISION;
+        if (num <= 0) return;
+        int64_t trigger = HFTUtils::divideRounded(num, qty * (RATE_PRECISION - maintenanceRate_), Rounding::Up) - 1;
+        s.trigger = longs_.emplace(trigger, ownerId);
+    } else {
+        // Underwater above (collateral + qty * entry) / (qty * (1 + m))
+        __int128 num = (a.collateral + qty * a.entryPriceTick) * RATE_PRECISION;
+        int64_t trigger = HFTUtils::divideRounded(num, qty * (RATE_PRECISION + maintenanceRate_), Rounding::Down) + 1;
+        s.trigger = shorts_.emplace(trigger, ownerId);
+    }
+    s.indexed = true;
+}
+
+void LiquidationEngine::unindex(AccountState& s) {
+    if (!s.indexed) return;
+    (s.account.position > 0 ? longs_ : shorts_).erase(s.trigger);
+    s.indexed = false;
+}
+
+LiquidationEngine::AccountState& LiquidationEngine::state(uint32_t ownerId) {
+    return accounts_.at(ownerId);
+}
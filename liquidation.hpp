@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <vector>
+#include "orderbook.hpp"
+#include "owner_table.hpp"
+
+
+// Isolated-margin liquidations for one perpetual book. Each account with a
+// position is indexed by its trigger tick in an ordered map per side: the
+// highest mark at which a long is underwater, the lowest for a short. A mark
+// update walks only the triggered end of each map, so it costs O(k log n)
+// for k liquidations among n indexed accounts and never visits a healthy
+// one. Triggered accounts are closed most-underwater first with IOC orders
+// bounded slippageTicks through the mark; fills realise PnL into collateral,
+// and any unfilled remainder is re-indexed at its new trigger and retried on
+// the next mark. An account closed below zero collateral is reset to zero
+// and the shortfall is added to badDebt.
+//
+// An account is underwater when collateral + position * (mark - entry) falls
+// below maintenanceRate * |position| * mark. Prices are ticks, collateral is
+// notional (ticks * qty) and rates are millionths.
+//
+// Not thread-safe: drive it from one thread. Accounts are hashed by owner
+// id, so ids need not be dense. Liquidation orders trade under the
+// account's own owner id; their client ids are taken from
+// LIQUIDATION_ID_BASE upward.
+class LiquidationEngine {
+public:
+    static constexpr int64_t RATE_PRECISION = 1000000;
+    static constexpr uint64_t LIQUIDATION_ID_BASE = 1ULL << 63;
+
+    struct Account {
+        int64_t position = 0;           // signed quantity
+        int64_t entryPriceTick = 0;
+        int64_t collateral = 0;
+    };
+
+    struct Stats {
+        uint64_t liquidations = 0;      // orders submitted
+        uint64_t quantity = 0;          // quantity closed
+        int64_t  badDebt = 0;           // negative collateral absorbed at close
+    };
+
+    LiquidationEngine(OrderBook& book, int32_t maintenanceRate, int64_t slippageTicks);
+
+    // Replaces the account and re-indexes it; a zero position removes it
+    void setAccount(uint32_t ownerId, const Account& account);
+    const Account& account(uint32_t ownerId) const;
+
+    // Trigger tick, or INT64_MIN/INT64_MAX (long/short) when not indexed
+    int64_t triggerPrice(uint32_t ownerId) const;
+
+    // Liquidates every account underwater at the mark; returns orders sent
+    size_t onMarkPrice(int64_t markPriceTick);
+
+    const Stats& stats() const { return stats_; }
+    size_t indexedAccounts() const { return longs_.size() + shorts_.size(); }
+
+private:
+    using TriggerMap = std::multimap<int64_t, uint32_t>;
+
+    struct AccountState {
+        Account account;
+        TriggerMap::iterator trigger;
+        bool indexed = false;
+    };
+
+    AccountState& state(uint32_t ownerId);
+    void index(uint32_t ownerId);
+    void unindex(AccountState& s);
+    void liquidate(uint32_t ownerId, int64_t markPriceTick);
+
+    OrderBook& book_;
+    int32_t maintenanceRate_;
+    int64_t slippageTicks_;
+    uint64_t nextClientId_ = LIQUIDATION_ID_BASE;
+
+    OwnerTable<AccountState> accounts_;
+    TriggerMap longs_;          // trigger: liquidate while mark <= trigger
+    TriggerMap shorts_;         // trigger: liquidate while mark >= trigger
+
+    // Scratch reused between mark updates
+    std::vector<uint32_t> triggered_;
+    std::vector<Fill> fills_;
+
+    Stats stats_;
+};
@@ -0,0 +1,168 @@
+// Renders a Logger binary file as text, one line per entry:
+//   <seconds since epoch>.<nanoseconds> T<thread> <formatted message>
+// Usage: log_decoder <file>
+#include "logger.hpp"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Format {
+        std::string types;
+        std::string text;
+        bool known = false;
+    };
+
+    bool isFloatConversion(char c) {
+        return c == 'f' || c == 'F' || c == 'e' || c == 'E' || c == 'g' || c == 'G' || c == 'a' || c == 'A';
+    }
+
+    // Expands each printf conversion with the next argument; length
+    // modifiers in the format are ignored since every argument is 8 bytes
+    void render(std::string& line, const Format& format, const uint64_t* args, uint32_t argCount) {
+        const std::string& text = format.text;
+        uint32_t next = 0;
+        char buffer[128];
+
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (text[i] != '%') {
+                line += text[i];
+                continue;
+            }
+            if (i + 1 < text.size() && text[i + 1] == '%') {
+                line += '%';
+                ++i;
+                continue;
+            }
+
+            // Flags, width and precision are kept; length modifiers dropped
+            std::string spec = "%";
+            size_t j = i + 1;
+            while (j < text.size() && std::strchr("-+ #0123456789.", text[j])) spec += text[j++];
+            while (j < text.size() && std::strchr("hlLqjzt", text[j])) ++j;
+            if (j >= text.size()) {
+                line += text.substr(i);
+                break;
+            }
+            char conversion = text[j];
+            i = j;
+
+            if (next >= argCount) {
+                line += "<missing>";
+                continue;
+            }
+            char type = next < format.types.size() ? format.types[next] : 'u';
+            uint64_t word = args[next++];
+            double d;
+            std::memcpy(&d, &word, sizeof(d));
+
+            if (isFloatConversion(conversion)) {
+                double value = type == 'f' ? d : type == 'i' ? double(int64_t(word)) : double(word);
+                std::snprintf(buffer, sizeof(buffer), (spec + conversion).c_str(), value);
+            } else if (conversion == 'c') {
+                std::snprintf(buffer, sizeof(buffer), (spec + 'c').c_str(), int(word));
+            } else if (conversion == 'd' || conversion == 'i') {
+                long long value = type == 'f' ? static_cast<long long>(d) : static_cast<long long>(word);
+                std::snprintf(buffer, sizeof(buffer), (spec + "ll" + conversion).c_str(), value);
+            } else if (conversion == 'u' || conversion == 'x' || conversion == 'X' || conversion == 'o') {
+                unsigned long long value = type == 'f' ? static_cast<unsigned long long>(d) : word;
+                std::snprintf(buffer, sizeof(buffer), (spec + "ll" + conversion).c_str(), value);
+            } else {
+                std::snprintf(buffer, sizeof(buffer), "<%%%c?>", conversion);
+            }
+            line += buffer;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s <log file>\n", argv[0]);
+        return 2;
+    }
+    FILE* file = std::fopen(argv[1], "rb");
+    if (!file) {
+        std::perror(argv[1]);
+        return 1;
+    }
+
+    LogFileHeader fileHeader;
+    if (std::fread(&fileHeader, sizeof(fileHeader), 1, file) != 1 ||
+        fileHeader.magic != LOG_FILE_MAGIC || fileHeader.version != LOG_FILE_VERSION) {
+        std::fprintf(stderr, "%s: not a version %u binary log\n", argv[1], LOG_FILE_VERSION);
+        std::fclose(file);
+        return 1;
+    }
+
+    std::vector<Format> formats;
+    std::vector<char> payload;
+    LogSyncRecord sync{0, 0, 1.0};
+    std::string line;
+    uint64_t dropped = 0;
+
+    LogRecordHeader header;
+    while (std::fread(&header, sizeof(header), 1, file) == 1) {
+        payload.resize(header.size);
+        if (header.size && std::fread(payload.data(), header.size, 1, file) != 1) {
+            std::fprintf(stderr, "%s: truncated record\n", argv[1]);
+            break;
+        }
+
+        switch (header.kind) {
+            case LogRecordKind::Format: {
+                LogFormatRecord record;
+                if (header.size < sizeof(record)) break;
+                std::memcpy(&record, payload.data(), sizeof(record));
+                if (sizeof(record) + record.argCount > header.size) break;
+                if (record.formatId >= formats.size()) formats.resize(record.formatId + 1);
+                Format& format = formats[record.formatId];
+                const char* p = payload.data() + sizeof(record);
+                format.types.assign(p, record.argCount);
+                format.text.assign(p + record.argCount, header.size - sizeof(record) - record.argCount);
+                format.known = true;
+                break;
+            }
+            case LogRecordKind::Sync:
+                if (header.size >= sizeof(sync)) std::memcpy(&sync, payload.data(), sizeof(sync));
+                break;
+            case LogRecordKind::Entry: {
+                LogEntryRecord entry;
+                if (header.size < sizeof(entry)) break;
+                std::memcpy(&entry, payload.data(), sizeof(entry));
+                uint32_t argCount = std::min<uint32_t>(entry.argCount,
+                                                       (header.size - sizeof(entry)) / sizeof(uint64_t));
+                std::vector<uint64_t> args(argCount);
+                if (argCount) std::memcpy(args.data(), payload.data() + sizeof(entry), argCount * sizeof(uint64_t));
+
+                // Entries drained after a sync may predate it
+                int64_t delta = static_cast<int64_t>(entry.ticks - sync.ticks);
+                uint64_t ns = sync.wallNs + static_cast<int64_t>(delta * sync.nsPerTick);
+
+                line.clear();
+                if (entry.formatId < formats.size() && formats[entry.formatId].known) {
+                    render(line, formats[entry.formatId], args.data(), argCount);
+                } else {
+                    line = "<unknown format " + std::to_string(entry.formatId) + ">";
+                }
+                std::printf("%" PRIu64 ".%09" PRIu64 " T%u %s\n", ns / 1000000000, ns % 1000000000,
+                            static_cast<unsigned>(header.thread), line.c_str());
+                break;
+            }
+            case LogRecordKind::Dropped: {
+                uint64_t lost = 0;
+                if (header.size >= sizeof(lost)) std::memcpy(&lost, payload.data(), sizeof(lost));
+                dropped += lost;
+                std::printf("-- T%u dropped %" PRIu64 " entries\n", static_cast<unsigned>(header.thread), lost);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    std::fclose(file);
+    if (dropped) std::fprintf(stderr, "%" PRIu64 " entries dropped\n", dropped);
+    return 0;
+}
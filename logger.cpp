@@ -0,0 +1,216 @@
+#include "logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+    constexpr uint64_t SYNC_INTERVAL_NS = 1000000000;
+    constexpr auto IDLE_SLEEP = std::chrono::microseconds(50);
+
+    std::atomic<uint64_t> nextLoggerId{1};
+
+    struct FormatRegistry {
+        std::mutex mutex;
+        std::vector<const char*> texts;
+        std::vector<const char*> types;
+        std::vector<uint32_t> argCounts;
+    };
+
+    FormatRegistry& formatRegistry() {
+        static FormatRegistry registry;
+        return registry;
+    }
+
+    uint64_t steadyNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    uint64_t wallNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    void append(std::vector<char>& out, const void* data, size_t size) {
+        const char* p = static_cast<const char*>(data);
+        out.insert(out.end(), p, p + size);
+    }
+
+    void appendHeader(std::vector<char>& out, LogRecordKind kind, uint16_t thread, size_t size) {
+        LogRecordHeader header{kind, thread, static_cast<uint32_t>(size)};
+        append(out, &header, sizeof(header));
+    }
+}
+
+Logger::ThreadRing::ThreadRing(size_t words, std::thread::id owner) : owner_(owner) {
+    size_t size = 1;
+    while (size < words) size <<= 1;
+    buffer_.resize(size);
+    mask_ = size - 1;
+}
+
+Logger::Logger(const char* path, size_t ringWords)
+    : id_(nextLoggerId.fetch_add(1, std::memory_order_relaxed)),
+      ringWords_(std::max<size_t>(ringWords, 2 + MAX_ARGS)) {
+    fd_ = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    // Short calibration so the first sync record already converts ticks;
+    // later ones refine it over the whole run
+    startTicks_ = now();
+    startSteadyNs_ = steadyNs();
+    uint64_t steady;
+    while ((steady = steadyNs()) - startSteadyNs_ < 1000000) {}
+    uint64_t ticks = now() - startTicks_;
+    nsPerTick_ = ticks ? double(steady - startSteadyNs_) / ticks : 1.0;
+
+    if (fd_ >= 0) writer_ = std::thread(&Logger::writerLoop, this);
+}
+
+Logger::~Logger() {
+    running_.store(false, std::memory_order_release);
+    if (writer_.joinable()) writer_.join();
+    if (fd_ >= 0) ::close(fd_);
+}
+
+void Logger::flush() {
+    if (fd_ < 0) return;
+    uint64_t request = flushRequests_.fetch_add(1) + 1;
+    while (flushesDone_.load(std::memory_order_acquire) < request) {
+        std::this_thread::sleep_for(IDLE_SLEEP);
+    }
+}
+
+uint64_t Logger::getDropped() const {
+    std::lock_guard<std::mutex> lock(ringsMutex_);
+    uint64_t dropped = 0;
+    for (const auto& ring : rings_) dropped += ring->dropped_.load(std::memory_order_relaxed);
+    return dropped;
+}
+
+uint32_t Logger::registerFormat(const char* text, const char* types, uint32_t argCount) {
+    FormatRegistry& registry = formatRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.texts.push_back(text);
+    registry.types.push_back(types);
+    registry.argCounts.push_back(argCount);
+    return static_cast<uint32_t>(registry.texts.size() - 1);
+}
+
+Logger::ThreadRing* Logger::attachThread() {
+    RingCache& cache = ringCache();
+    cache.loggerId = id_;
+    cache.ring = nullptr;
+    if (fd_ < 0) return nullptr;
+
+    // A thread that logged here before, then to another logger, gets its
+    // own ring back: each ring must keep a single producer
+    std::thread::id self = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lock(ringsMutex_);
+    for (const auto& ring : rings_) {
+        if (ring->owner_ == self) return cache.ring = ring.get();
+    }
+    if (rings_.size() > UINT16_MAX) return nullptr;
+    rings_.push_back(std::make_unique<ThreadRing>(ringWords_, self));
+    return cache.ring = rings_.back().get();
+}
+
+void Logger::writerLoop() {
+    std::vector<char> out;
+    LogFileHeader header{LOG_FILE_MAGIC, LOG_FILE_VERSION};
+    append(out, &header, sizeof(header));
+    appendSync(out);
+
+    for (;;) {
+        bool stopping = !running_.load(std::memory_order_acquire);
+        uint64_t requested = flushRequests_.load(std::memory_order_acquire);
+
+        // One pass covers everything logged before the flush request was read
+        bool busy = drain(out);
+        if (steadyNs() - lastSyncSteadyNs_ >= SYNC_INTERVAL_NS) appendSync(out);
+        writeOut(out);
+        flushesDone_.store(requested, std::memory_order_release);
+
+        if (stopping) break;
+        if (!busy) std::this_thread::sleep_for(IDLE_SLEEP);
+    }
+}
+
+bool Logger::drain(std::vector<char>& out) {
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        drainList_.clear();
+        for (const auto& ring : rings_) drainList_.push_back(ring.get());
+    }
+
+    bool drained = false;
+    for (size_t thread = 0; thread < drainList_.size(); ++thread) {
+        ThreadRing& ring = *drainList_[thread];
+        uint64_t head = ring.head_.load(std::memory_order_relaxed);
+        uint64_t tail = ring.tail_.load(std::memory_order_acquire);
+
+        while (head != tail) {
+            uint64_t word = ring.buffer_[head & ring.mask_];
+            uint32_t formatId = static_cast<uint32_t>(word);
+            uint32_t argCount = static_cast<uint32_t>(word >> 32);
+
+            if (UNLIKELY(formatId >= formatsWritten_.size() || !formatsWritten_[formatId])) {
+                FormatRegistry& registry = formatRegistry();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                if (formatId >= formatsWritten_.size()) formatsWritten_.resize(registry.texts.size());
+                size_t textSize = std::strlen(registry.texts[formatId]);
+                LogFormatRecord record{formatId, registry.argCounts[formatId]};
+                appendHeader(out, LogRecordKind::Format, 0, sizeof(record) + record.argCount + textSize);
+                append(out, &record, sizeof(record));
+                append(out, registry.types[formatId], record.argCount);
+                append(out, registry.texts[formatId], textSize);
+                formatsWritten_[formatId] = true;
+            }
+
+            LogEntryRecord entry{formatId, argCount, ring.buffer_[(head + 1) & ring.mask_]};
+            appendHeader(out, LogRecordKind::Entry, static_cast<uint16_t>(thread),
+                         sizeof(entry) + argCount * sizeof(uint64_t));
+            append(out, &entry, sizeof(entry));
+            for (uint32_t i = 0; i < argCount; ++i) {
+                append(out, &ring.buffer_[(head + 2 + i) & ring.mask_], sizeof(uint64_t));
+            }
+            head += 2 + argCount;
+            drained = true;
+        }
+        ring.head_.store(head, std::memory_order_release);
+
+        uint64_t dropped = ring.dropped_.load(std::memory_order_relaxed);
+        if (UNLIKELY(dropped != ring.droppedReported_)) {
+            uint64_t lost = dropped - ring.droppedReported_;
+            appendHeader(out, LogRecordKind::Dropped, static_cast<uint16_t>(thread), sizeof(lost));
+            append(out, &lost, sizeof(lost));
+            ring.droppedReported_ = dropped;
+        }
+    }
+    return drained;
+}
+
+void Logger::appendSync(std::vector<char>& out) {
+    uint64_t ticks = now();
+    uint64_t steady = steadyNs();
+    if (ticks > startTicks_ && steady - startSteadyNs_ >= SYNC_INTERVAL_NS) {
+        nsPerTick_ = double(steady - startSteadyNs_) / (ticks - startTicks_);
+    }
+    LogSyncRecord sync{ticks, wallNs(), nsPerTick_};
+    appendHeader(out, LogRecordKind::Sync, 0, sizeof(sync));
+    append(out, &sync, sizeof(sync));
+    lastSyncSteadyNs_ = steady;
+}
+
+void Logger::writeOut(std::vector<char>& out) {
+    size_t written = 0;
+    while (written < out.size()) {
+        ssize_t n = ::write(fd_, out.data() + written, out.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        written += static_cast<size_t>(n);
+    }
+    out.clear();
+}
@@ -0,0 +1,245 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifndef LIKELY
+#if defined(__GNUC__) || defined(__clang__)
+    #define LIKELY(x)   __builtin_expect(!!(x), 1)
+    #define UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+    #define LIKELY(x)   (x)
+    #define UNLIKELY(x) (x)
+#endif
+#endif
+
+// Binary log wire format, native endianness. A file is a LogFileHeader and
+// then a sequence of records, each a LogRecordHeader followed by size
+// payload bytes:
+//   Format  LogFormatRecord, argCount type chars, then the format string
+//   Sync    LogSyncRecord; entry timestamps after it convert through it
+//   Entry   LogEntryRecord, then argCount 8-byte arguments
+//   Dropped uint64_t entries lost to a full ring since the last report
+// A format record always precedes the first entry that uses it. Argument
+// types are 'i' (int64_t), 'u' (uint64_t) and 'f' (double).
+enum class LogRecordKind : uint16_t {
+    Format,
+    Sync,
+    Entry,
+    Dropped
+};
+
+struct LogFileHeader {
+    uint32_t magic;
+    uint32_t version;
+};
+
+struct LogRecordHeader {
+    LogRecordKind kind;
+    uint16_t      thread;        // ring index, in order of each thread's first log
+    uint32_t      size;
+};
+
+struct LogFormatRecord {
+    uint32_t formatId;
+    uint32_t argCount;
+};
+
+struct LogSyncRecord {
+    uint64_t ticks;              // Logger::now() clock
+    uint64_t wallNs;             // nanoseconds since the epoch
+    double   nsPerTick;
+};
+
+struct LogEntryRecord {
+    uint32_t formatId;
+    uint32_t argCount;
+    uint64_t ticks;
+};
+
+static constexpr uint32_t LOG_FILE_MAGIC = 0x474f4c42;   // "BLOG"
+static constexpr uint32_t LOG_FILE_VERSION = 1;
+
+// Asynchronous binary logger. A call site costs a timestamp and a handful of
+// word stores into the calling thread's own SPSC ring: the format string is
+// registered once per site and only its id is logged, with each argument
+// widened to 8 raw bytes. Nothing is formatted on the hot path; a background
+// thread drains every ring into the file, and log_decoder renders it offline.
+// Timestamps are TSC ticks where available, converted by the sync records
+// the writer emits once a second.
+//
+// A full ring drops the entry and counts it rather than block the caller.
+// Rings are created on a thread's first log and live as long as the logger,
+// so the logger must outlive every thread that logs to it. Arguments must be
+// arithmetic or enums; format strings use printf conversions.
+//
+//   BOOK_LOG(logger, "fill maker=%lu qty=%u px=%ld", makerId, qty, priceTick);
+class Logger {
+public:
+    static constexpr size_t MAX_ARGS = 16;
+
+    // ringWords is the per-thread ring capacity in 8-byte words (an entry is
+    // two words plus one per argument)
+    explicit Logger(const char* path, size_t ringWords = 1 << 16);
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    bool isOpen() const { return fd_ >= 0; }
+
+    // Blocks until everything logged before the call is written
+    void flush();
+
+    uint64_t getDropped() const;
+
+    // Hot path; use BOOK_LOG, which supplies a per-site Format type
+    template <typename Format, typename... Args>
+    void log(Args... args) {
+        static_assert(sizeof...(Args) <= MAX_ARGS, "too many log arguments");
+        static const uint32_t formatId = registerFormat(Format::text(), argTypes<Args...>(), sizeof...(Args));
+
+        ThreadRing* ring = localRing();
+        if (UNLIKELY(!ring)) return;
+        uint64_t words[2 + sizeof...(Args)] = {
+            static_cast<uint64_t>(formatId) | static_cast<uint64_t>(sizeof...(Args)) << 32, now(), encode(args)...};
+        ring->push(words, 2 + sizeof...(Args));
+    }
+
+    static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+private:
+    struct ThreadRing {
+        ThreadRing(size_t words, std::thread::id owner);
+
+        void push(const uint64_t* words, size_t count) {
+            uint64_t tail = tail_.load(std::memory_order_relaxed);
+            if (UNLIKELY(tail + count - headCache_ > buffer_.size())) {
+                headCache_ = head_.load(std::memory_order_acquire);
+                if (tail + count - headCache_ > buffer_.size()) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+            for (size_t i = 0; i < count; ++i) buffer_[(tail + i) & mask_] = words[i];
+            tail_.store(tail + count, std::memory_order_release);
+        }
+        size_t capacity() const { return buffer_.size(); }
+
+        std::vector<uint64_t> buffer_;
+        size_t mask_;
+        uint64_t headCache_ = 0;                          // producer's view of head_
+        alignas(64) std::atomic<uint64_t> head_{0};       // next word to consume
+        alignas(64) std::atomic<uint64_t> tail_{0};       // next word to produce
+        std::atomic<uint64_t> dropped_{0};
+        std::thread::id owner_;
+        uint64_t droppedReported_ = 0;                    // writer thread only
+    };
+
+    struct FormatInfo {
+        const char* text;
+        const char* types;
+        uint32_t argCount;
+    };
+
+    template <typename T>
+    static constexpr char argType() {
+        static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value,
+                      "log arguments must be arithmetic or enums");
+        if constexpr (std::is_floating_point<T>::value) {
+            return 'f';
+        } else if constexpr (std::is_enum<T>::value) {
+            return std::is_signed<std::underlying_type_t<T>>::value ? 'i' : 'u';
+        } else {
+            return std::is_signed<T>::value ? 'i' : 'u';
+        }
+    }
+
+    template <typename... Args>
+    static const char* argTypes() {
+        static const char types[] = {argType<Args>()..., '\0'};
+        return types;
+    }
+
+    template <typename T>
+    static uint64_t encode(T value) {
+        uint64_t word;
+        if constexpr (std::is_floating_point<T>::value) {
+            double d = static_cast<double>(value);
+            std::memcpy(&word, &d, sizeof(word));
+        } else if constexpr (std::is_enum<T>::value) {
+            word = static_cast<uint64_t>(static_cast<std::underlying_type_t<T>>(value));
+        } else {
+            word = static_cast<uint64_t>(value);
+        }
+        return word;
+    }
+
+    // Process-wide, so a site's id is valid for every logger
+    static uint32_t registerFormat(const char* text, const char* types, uint32_t argCount);
+
+    ThreadRing* localRing() {
+        auto& cache = ringCache();
+        if (LIKELY(cache.loggerId == id_)) return cache.ring;
+        return attachThread();
+    }
+
+    struct RingCache {
+        uint64_t loggerId = 0;
+        ThreadRing* ring = nullptr;
+    };
+    static RingCache& ringCache() {
+        static thread_local RingCache cache;
+        return cache;
+    }
+
+    ThreadRing* attachThread();
+    void writerLoop();
+    bool drain(std::vector<char>& out);
+    void appendSync(std::vector<char>& out);
+    void writeOut(std::vector<char>& out);
+
+    int fd_ = -1;
+    uint64_t id_;
+    size_t ringWords_;
+
+    // Rings in attach order; the writer copies the list under the mutex
+    mutable std::mutex ringsMutex_;
+    std::vector<std::unique_ptr<ThreadRing>> rings_;
+
+    // Writer thread state
+    std::vector<ThreadRing*> drainList_;
+    std::vector<bool> formatsWritten_;
+    uint64_t startTicks_;
+    uint64_t startSteadyNs_;
+    double nsPerTick_;
+    uint64_t lastSyncSteadyNs_ = 0;
+
+    std::atomic<bool> running_{true};
+    std::atomic<uint64_t> flushRequests_{0};
+    std::atomic<uint64_t> flushesDone_{0};
+    std::thread writer_;
+};
+
+#define BOOK_LOG(logger, format, ...)                                            \
+    do {                                                                         \
+        struct BookLogFormat_ { static const char* text() { return format; } }; \
+        (logger).template log<BookLogFormat_>(__VA_ARGS__);                      \
+    } while (0)
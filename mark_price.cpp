@@ -0,0 +1,109 @@
+#include "mark_price.hpp"
+#include <algorithm>
+
+MarkPriceEngine::MarkPriceEngine(uint64_t windowNs, size_t bucketCount, int64_t rateCap)
+    : bucketNs_(std::max<uint64_t>(windowNs / std::max<size_t>(bucketCount, 1), 1)),
+      rateCap_(rateCap),
+      buckets_(std::max<size_t>(bucketCount, 1)) {}
+
+void MarkPriceEngine::onQuote(uint64_t timestamp, const TopOfBook& top) {
+    advance(timestamp);
+    WeightedMid mid = OrderBook::computeWeightedMid(top.bid, top.ask, Rounding::HalfEven);
+    current_.midSubTicks = mid.subTicks;
+    current_.midValid = mid.valid;
+    publish();
+}
+
+void MarkPriceEngine::onTrade(uint64_t timestamp, int64_t priceTick) {
+    advance(timestamp);
+    current_.lastTradeSubTicks = priceTick * MID_PRECISION;
+    current_.lastTradeValid = true;
+    publish();
+}
+
+void MarkPriceEngine::setIndexPrice(uint64_t timestamp, int64_t indexSubTicks) {
+    advance(timestamp);
+    current_.indexSubTicks = indexSubTicks;
+    current_.indexValid = indexSubTicks > 0;
+    publish();
+}
+
+void MarkPriceEngine::advance(uint64_t timestamp) {
+    if (UNLIKELY(!started_)) {
+        started_ = true;
+        now_ = timestamp;
+        currentBucket_ = timestamp / bucketNs_;
+    }
+    if (timestamp <= now_) return;
+
+    // Integrate the premium that held since the last update
+    bool accrue = current_.midValid && current_.indexValid;
+    __int128 premium = accrue ? current_.midSubTicks - current_.indexSubTicks : 0;
+
+    uint64_t windowNs = bucketNs_ * buckets_.size();
+    if (UNLIKELY(timestamp - now_ >= windowNs)) {
+        clearWindow();
+        now_ = timestamp - windowNs;
+    }
+
+    while (now_ < timestamp) {
+        uint64_t bucket = now_ / bucketNs_;
+        Bucket& b = buckets_[bucket % buckets_.size()];
+        if (bucket != currentBucket_) {
+            // Entering a bucket expires what it held one window ago
+            currentBucket_ = bucket;
+            premiumNs_ -= b.premiumNs;
+            coveredNs_ -= b.coveredNs;
+            b = Bucket();
+        }
+        uint64_t end = std::min(timestamp, (bucket + 1) * bucketNs_);
+        if (accrue) {
+            uint64_t dt = end - now_;
+            b.premiumNs += premium * dt;
+            b.coveredNs += dt;
+            premiumNs_ += premium * dt;
+            coveredNs_ += dt;
+        }
+        now_ = end;
+    }
+}
+
+void MarkPriceEngine::clearWindow() {
+    std::fill(buckets_.begin(), buckets_.end(), Bucket());
+    premiumNs_ = 0;
+    coveredNs_ = 0;
+}
+
+void MarkPriceEngine::publish() {
+    MarkSnapshot& s = current_;
+    s.timestamp = now_;
+
+    int64_t inputs[3];
+    size_t n = 0;
+    if (s.midValid) inputs[n++] = s.midSubTicks;
+    if (s.indexValid) inputs[n++] = s.indexSubTicks;
+    if (s.lastTradeValid) inputs[n++] = s.lastTradeSubTicks;
+    std::sort(inputs, inputs + n);
+
+    s.markValid = n > 0;
+    if (n == 3) {
+        s.markSubTicks = inputs[1];
+    } else if (n == 2) {
+        s.markSubTicks = HFTUtils::divideRounded(static_cast<__int128>(inputs[0]) + inputs[1], 2, Rounding::HalfEven);
+    } else {
+        s.markSubTicks = n ? inputs[0] : 0;
+    }
+
+    s.fundingValid = coveredNs_ > 0 && s.indexValid;
+    if (s.fundingValid) {
+        s.premiumTwapSubTicks = HFTUtils::divideRounded(premiumNs_, coveredNs_, Rounding::HalfEven);
+        int64_t rate = HFTUtils::divideRounded(static_cast<__int128>(s.premiumTwapSubTicks) * RATE_PRECISION,
+                                               s.indexSubTicks, Rounding::HalfEven);
+        s.fundingRate = std::max(-rateCap_, std::min(rateCap_, rate));
+    } else {
+        s.premiumTwapSubTicks = 0;
+        s.fundingRate = 0;
+    }
+
+    published_.store(s);
+}
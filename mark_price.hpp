@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "orderbook.hpp"
+
+
+// Everything a mark consumer needs, published as one consistent copy. Prices
+// are sub-ticks (priceTick * MID_PRECISION); a zero timestamp means nothing
+// has been published yet.
+struct MarkSnapshot {
+    uint64_t timestamp;
+    int64_t  markSubTicks;           // median of mid, index and last trade
+    int64_t  midSubTicks;            // size-weighted book mid
+    int64_t  indexSubTicks;
+    int64_t  lastTradeSubTicks;
+    int64_t  premiumTwapSubTicks;    // time-weighted mid - index over the window
+    int64_t  fundingRate;            // premium TWAP / index, millionths, capped
+    bool     markValid;
+    bool     midValid;
+    bool     indexValid;
+    bool     lastTradeValid;
+    bool     fundingValid;           // some premium was observed in the window
+};
+
+// Mark price and funding premium for one perpetual book, fed from its
+// top-of-book stream, trades and an external index. The mark is the median
+// of the weighted mid, the index and the last trade; with one input missing
+// it is the mean of the other two.
+//
+// The premium (mid - index) is integrated over time into a ring of equal
+// buckets spanning the funding window. Running sums are kept alongside, so
+// an update adds to the current bucket and expires at most the buckets
+// crossed since the last one: O(1) amortised, and a gap longer than the
+// window is bounded by one pass over the ring. Time with no mid or no index
+// does not count towards the TWAP.
+//
+// Every update republishes a MarkSnapshot through a seqlock; snapshot() is
+// lock-free and may be called from any thread, so liquidation and PnL
+// readers never take the book lock. The on* methods are the single writer
+// and must be driven from one thread. Timestamps are nanoseconds and should
+// not go backwards; an older one is treated as the last seen.
+class MarkPriceEngine {
+public:
+    static constexpr int64_t RATE_PRECISION = 1000000;
+
+    // windowNs is split into bucketCount buckets; rateCap bounds |fundingRate|
+    MarkPriceEngine(uint64_t windowNs, size_t bucketCount, int64_t rateCap);
+
+    void onQuote(uint64_t timestamp, const TopOfBook& top);
+    void onTrade(uint64_t timestamp, int64_t priceTick);
+    void onFill(const Fill& fill) { onTrade(fill.timestamp, fill.priceTick); }
+    void setIndexPrice(uint64_t timestamp, int64_t indexSubTicks);
+
+    MarkSnapshot snapshot() const { return published_.load(); }
+
+private:
+    struct Bucket {
+        __int128 premiumNs = 0;      // premium sub-ticks * ns
+        uint64_t coveredNs = 0;      // time with a premium
+    };
+
+    void advance(uint64_t timestamp);
+    void clearWindow();
+    void publish();
+
+    uint64_t bucketNs_;
+    int64_t rateCap_;
+    std::vector<Bucket> buckets_;
+    uint64_t currentBucket_ = 0;     // absolute bucket number, now_ / bucketNs_
+    uint64_t now_ = 0;
+    bool started_ = false;
+
+    // Running sums over buckets_
+    __int128 premiumNs_ = 0;
+    uint64_t coveredNs_ = 0;
+
+    MarkSnapshot current_{};
+    HFTUtils::SeqLock<MarkSnapshot> published_;
+};
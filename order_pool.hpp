@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+static constexpr uint32_t INVALID_SLOT = UINT32_MAX;
+
+// Reference to a pooled order: 32-bit slot index plus the slot's generation
+// at allocation time. A handle goes stale once its order leaves the book.
+class OrderHandle {
+public:
+    OrderHandle() = default;
+
+    bool valid() const { return slot_ != INVALID_SLOT; }
+    explicit operator bool() const { return valid(); }
+
+    bool operator==(const OrderHandle& other) const {
+        return slot_ == other.slot_ && generation_ == other.generation_;
+    }
+    bool operator!=(const OrderHandle& other) const { return !(*this == other); }
+
+private:
+    template <typename> friend class OrderPool;
+    OrderHandle(uint32_t slot, uint32_t generation) : slot_(slot), generation_(generation) {}
+
+    uint32_t slot_ = INVALID_SLOT;
+    uint32_t generation_ = 0;
+};
+
+// Slot allocator for resting orders. Slots are addressed by index, so the
+// backing vector may grow without invalidating level queues or handles.
+// Odd generations mark live slots; every allocate/release bumps it.
+// prev/next link a live slot into its price level's FIFO, and next threads
+// the free list while the slot is released.
+template <typename T>
+class OrderPool {
+public:
+    struct Slot : T {
+        uint32_t generation;
+        uint32_t prev;
+        uint32_t next;
+    };
+
+    explicit OrderPool(size_t capacity = 0) { slots_.reserve(capacity); }
+
+    uint32_t allocate() {
+        uint32_t index;
+        if (freeHead_ != INVALID_SLOT) {
+            index = freeHead_;
+            freeHead_ = slots_[index].next;
+        } else {
+            index = static_cast<uint32_t>(slots_.size());
+            slots_.emplace_back();
+            slots_[index].generation = generationFloor_;
+        }
+        Slot& slot = slots_[index];
+        slot.generation += 1;
+        slot.prev = INVALID_SLOT;
+        slot.next = INVALID_SLOT;
+        ++live_;
+        return index;
+    }
+
+    void release(uint32_t index) {
+        Slot& slot = slots_[index];
+        slot.generation += 1;
+        slot.next = freeHead_;
+        freeHead_ = index;
+        --live_;
+    }
+
+    Slot& operator[](uint32_t index) { return slots_[index]; }
+    const Slot& operator[](uint32_t index) const { return slots_[index]; }
+
+    OrderHandle handle(uint32_t index) const { return {index, slots_[index].generation}; }
+
+    // Slot index for a live handle, INVALID_SLOT if stale
+    uint32_t resolve(OrderHandle h) const {
+        if (h.slot_ >= slots_.size()) return INVALID_SLOT;
+        uint32_t generation = slots_[h.slot_].generation;
+        return (generation == h.generation_ && (generation & 1)) ? h.slot_ : INVALID_SLOT;
+    }
+
+    bool isLive(uint32_t index) const { return slots_[index].generation & 1; }
+
+    size_t size() const { return slots_.size(); }
+    size_t liveCount() const { return live_; }
+    size_t memoryBytes() const { return slots_.capacity() * sizeof(Slot); }
+
+    // Drops every slot and shrinks to capacity. New slots start above any
+    // generation handed out so far, so outstanding handles stay stale.
+    void reset(size_t capacity) {
+        for (const Slot& slot : slots_) {
+            if (slot.generation >= generationFloor_) generationFloor_ = (slot.generation | 1) + 1;
+        }
+        std::vector<Slot>().swap(slots_);
+        slots_.reserve(capacity);
+        freeHead_ = INVALID_SLOT;
+        live_ = 0;
+    }
+
+private:
+    std::vector<Slot> slots_;
+    uint32_t freeHead_ = INVALID_SLOT;
+    size_t live_ = 0;
+    uint32_t generationFloor_ = 0;     // even; first generation of a new slot
+};
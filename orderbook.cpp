@@ -1,12 +1,161 @@
-#include "order_book.hpp"
+#include "orderbook.hpp"
+#include "fee_engine.hpp"
+#include "implied.hpp"
+#include "logger.hpp"
 #include <algorithm>
+#include <cerrno>
 #include <chrono>
+#include <cstring>
 #include <mutex>
+#include <numeric>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace HFTUtils;
 
-OrderBook::OrderBook(size_t maxOrders) {
-    orders_.reserve(maxOrders);
+namespace {
+    // Recycles fill staging capacity between operations on the same thread
+    std::vector<Fill>& spareFillBuffer() {
+        static thread_local std::vector<Fill> buffer;
+        return buffer;
+    }
+    
+    // Snapshot wire format, native endianness
+    constexpr uint32_t SNAPSHOT_MAGIC = 0x4b4f4f42;   // "BOOK"
+    constexpr uint32_t SNAPSHOT_VERSION = 4;
+    
+    // Header, orderCount SnapshotRecords, then positionCount SnapshotPositions
+    struct SnapshotHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t nextOrderId;
+        uint64_t orderCount;
+        uint64_t positionCount;
+    };
+    
+    struct SnapshotRecord {
+        uint64_t orderId;
+        uint64_t clientOrderId;
+        int64_t  priceTick;
+        uint64_t timestamp;
+        uint32_t quantity;
+        uint32_t filledQty;
+        uint32_t ownerId;
+        uint8_t  side;
+        uint8_t  type;
+        uint8_t  tif;
+        uint8_t  peg;
+        int32_t  pegOffset;
+        uint8_t  postOnly;
+        uint8_t  reduceOnly;
+        uint16_t padding;
+    };
+    
+    struct SnapshotPosition {
+        uint32_t ownerId;
+        uint32_t padding;
+        int64_t  position;
+    };
+    
+    // Buffered write()/read() with no heap use, so a forked child of a
+    // multi-threaded process can serialise without touching malloc
+    class FdWriter {
+    public:
+        explicit FdWriter(int fd) : fd_(fd) {}
+        
+        void put(const void* data, size_t size) {
+            if (len_ + size > sizeof(buf_)) flush();
+            // Too big to buffer (a hibernated book's image): write it through
+            if (size > sizeof(buf_)) {
+                writeAll(static_cast<const char*>(data), size);
+                return;
+            }
+            std::memcpy(buf_ + len_, data, size);
+            len_ += size;
+        }
+        
+        bool flush() {
+            writeAll(buf_, len_);
+            len_ = 0;
+            return ok_;
+        }
+        
+    private:
+        void writeAll(const char* data, size_t size) {
+            for (size_t off = 0; ok_ && off < size;) {
+                ssize_t n = ::write(fd_, data + off, size - off);
+                if (n > 0) off += static_cast<size_t>(n);
+                else if (n < 0 && errno == EINTR) continue;
+                else ok_ = false;
+            }
+        }
+        
+        int fd_;
+        bool ok_ = true;
+        size_t len_ = 0;
+        char buf_[64 * 1024];
+    };
+    
+    class FdReader {
+    public:
+        explicit FdReader(int fd) : fd_(fd) {}
+        
+        bool get(void* data, size_t size) {
+            char* p = static_cast<char*>(data);
+            while (size > 0) {
+                ssize_t n = ::read(fd_, p, size);
+                if (n > 0) { p += n; size -= static_cast<size_t>(n); }
+                else if (n < 0 && errno == EINTR) continue;
+                else return false;
+            }
+            return true;
+        }
+        
+    private:
+        int fd_;
+    };
+    
+    // In-memory equivalents for checkpoints and hibernated books
+    class VectorWriter {
+    public:
+        explicit VectorWriter(std::vector<char>& out) : out_(out) { out_.clear(); }
+        
+        void put(const void* data, size_t size) {
+            const char* p = static_cast<const char*>(data);
+            out_.insert(out_.end(), p, p + size);
+        }
+        bool flush() { return true; }
+        
+    private:
+        std::vector<char>& out_;
+    };
+    
+    class MemoryReader {
+    public:
+        MemoryReader(const char* data, size_t size) : data_(data), size_(size) {}
+        
+        bool get(void* data, size_t size) {
+            if (size > size_ - offset_) return false;
+            std::memcpy(data, data_ + offset_, size);
+            offset_ += size;
+            return true;
+        }
+        
+    private:
+        const char* data_;
+        size_t size_;
+        size_t offset_ = 0;
+    };
+}
+
+OrderBook::OrderBook(size_t expectedOrders, LockPolicy lockPolicy)
+    : lock_(lockPolicy),
+      bids_(LevelMap::allocator_type(&levelBytes_)),
+      asks_(LevelMap::allocator_type(&levelBytes_)),
+      pool_(expectedOrders),
+      orders_(OrderIdMap::allocator_type(&orderIdBytes_)),
+      clientIndex_(expectedOrders) {
+    orders_.reserve(expectedOrders);
 }
 
 uint64_t OrderBook::getCurrentTimeNs() const {
@@ -15,206 +164,646 @@ uint64_t OrderBook::getCurrentTimeNs() const {
     ).count();
 }
 
-bool OrderBook::submitOrder(const Order& o, std::vector<Fill>* fills) {
-    std::lock_guard<std::mutex> lock(mutex_);
+inline uint64_t OrderBook::startClock() const {
+    if constexpr (INSTRUMENTED) return getCurrentTimeNs();
+    return 0;
+}
+
+inline void OrderBook::recordOrder(uint64_t startTime, bool passive) {
+    if constexpr (INSTRUMENTED) {
+        uint64_t processingTime = getCurrentTimeNs() - startTime;
+        stats_.ordersProcessed.fetch_add(1, std::memory_order_relaxed);
+        if (passive) {
+            stats_.passiveOrdersProcessed.fetch_add(1, std::memory_order_relaxed);
+            stats_.avgPassiveTimeNs.store(processingTime, std::memory_order_relaxed);
+        } else {
+            stats_.avgProcessingTimeNs.store(processingTime, std::memory_order_relaxed);
+        }
+        size_t bucket = processingTime ? 64 - __builtin_clzll(processingTime) : 0;
+        stats_.latencyHistogram[std::min(bucket, Stats::LATENCY_BUCKETS - 1)].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+inline void OrderBook::recordFill(const Fill& fill) {
+    if constexpr (INSTRUMENTED) {
+        stats_.fillsGenerated.fetch_add(1, std::memory_order_relaxed);
+        if (UNLIKELY(logger_)) {
+            BOOK_LOG(*logger_, "fill maker=%lu taker=%lu qty=%u px=%ld",
+                     fill.makerOrderId, fill.takerOrderId, fill.quantity, fill.priceTick);
+        }
+    }
+}
+
+inline void OrderBook::recordReject(const Order& order, RejectReason reason) {
+    if constexpr (INSTRUMENTED) {
+        if (UNLIKELY(logger_)) {
+            BOOK_LOG(*logger_, "reject owner=%u id=%lu reason=%u", order.ownerId, order.id, reason);
+        }
+    }
+}
+
+OrderHandle OrderBook::submitOrder(const Order& o, std::vector<Fill>* fills) {
+    FillDispatch dispatch;
+    OrderHandle handle;
+    {
+        std::lock_guard<BookLock> lock(lock_);
+        handle = submitLocked(o, fills);
+        stageFills(dispatch);
+    }
+    dispatchFills(dispatch);
+    return handle;
+}
+
+OrderHandle OrderBook::submitLocked(const Order& o, std::vector<Fill>* fills) {
+    uint64_t startTime = startClock();
+    wakeLocked();
+    
+    if (UNLIKELY(o.quantity == 0)) {
+        publishReport(o, 0, ExecOutcome::Rejected, RejectReason::InvalidQuantity, 0, 0);
+        recordReject(o, RejectReason::InvalidQuantity);
+        return {};
+    }
+    
+    // Duplicate client id among the owner's live orders
+    if (UNLIKELY(clientIndex_.find(o.ownerId, o.id) != ClientOrderIndex::NOT_FOUND)) {
+        publishReport(o, 0, ExecOutcome::Rejected, RejectReason::DuplicateClientOrderId, 0, 0);
+        recordReject(o, RejectReason::DuplicateClientOrderId);
+        return {};
+    }
+    
+    // Post-only, reduce-only and min-qty resolve against cached state first
+    if (UNLIKELY(o.postOnly != PostOnly::None || o.reduceOnly || o.minQty != 0)) {
+        return submitFlagged(o, fills, startTime);
+    }
+    return submitAccepted(o, fills, startTime);
+}
+
+OrderHandle OrderBook::submitAccepted(const Order& o, std::vector<Fill>* fills, uint64_t startTime) {
+    if (UNLIKELY(o.peg != PegType::None)) {
+        return submitPeg(o, fills, startTime);
+    }
     
-    uint64_t startTime = getCurrentTimeNs();
+    // Passive fast path: a limit that cannot cross the cached opposite touch
+    // (displayed or pegged) skips the FOK check and matchLoop and goes
+    // straight onto the ladder. Implied quotes move with other books, so
+    // books in an implied engine always take the matching path.
+    if (LIKELY(o.type == OrderType::Limit) && LIKELY(implied_ == nullptr) &&
+        (o.side == Side::Buy ? o.priceTick < bestAskTick_.load(std::memory_order_relaxed) &&
+                               o.priceTick < pegBest_[1]
+                             : o.priceTick > bestBidTick_.load(std::memory_order_relaxed) &&
+                               o.priceTick > pegBest_[0])) {
+        if (UNLIKELY(o.tif == TimeInForce::FOK)) {
+            publishReport(o, 0, ExecOutcome::FokRejected, RejectReason::FokNotFillable, 0, 0);
+            return {};
+        }
+        uint64_t orderId = nextOrderId_++;
+        if (UNLIKELY(o.tif == TimeInForce::IOC)) {
+            publishReport(o, orderId, ExecOutcome::IocCancelled, RejectReason::None, 0, 0);
+            return {};
+        }
+        
+        OrderHandle handle = pool_.handle(restOrder(o, orderId, o.quantity, 0));
+        publishReport(o, orderId, ExecOutcome::Rested, RejectReason::None, o.quantity, 0, 0, 0, 0, handle);
+        
+        recordOrder(startTime, true);
+        return handle;
+    }
     
     // FOK pre-check
-    if (UNLIKELY(o.tif == TimeInForce::FOK && !canFullyFill(o))) {
-        return false;
+    if (UNLIKELY(o.tif == TimeInForce::FOK && !canFill(o, o.quantity))) {
+        publishReport(o, 0, ExecOutcome::FokRejected, RejectReason::FokNotFillable, 0, 0);
+        return {};
     }
 
+    uint64_t orderId = nextOrderId_++;
     uint32_t remaining = o.quantity;
-    matchLoop(o, remaining, fills);
+    matchLoop(o, orderId, remaining, fills);
+    uint32_t filled = o.quantity - remaining;
+    OrderHandle handle;
 
     // Handle remaining quantity
     if (remaining > 0) {
         if (UNLIKELY(o.tif == TimeInForce::IOC || o.tif == TimeInForce::FOK)) {
-            return true;
+            publishReport(o, orderId, ExecOutcome::IocCancelled, RejectReason::None, 0, filled);
+            return {};
         }
-        restOrder(o, remaining);
+        handle = pool_.handle(restOrder(o, orderId, remaining, filled));
+        publishReport(o, orderId, filled ? ExecOutcome::PartiallyFilled : ExecOutcome::Rested,
+                      RejectReason::None, remaining, filled, 0, 0, 0, handle);
+    } else {
+        publishReport(o, orderId, ExecOutcome::Filled, RejectReason::None, 0, filled);
     }
     
-    // Update performance statistics
-    uint64_t processingTime = getCurrentTimeNs() - startTime;
-    stats_.ordersProcessed.fetch_add(1, std::memory_order_relaxed);
-    stats_.avgProcessingTimeNs.store(processingTime, std::memory_order_relaxed);
-    
-    return true;
+    recordOrder(startTime, false);
+    return handle;
 }
 
-void OrderBook::matchLoop(const Order& incomingOrder, uint32_t& remaining, std::vector<Fill>* fills) {
-    auto& contraLevels = (incomingOrder.side == Side::Buy) ? asks_ : bids_;
+OrderHandle OrderBook::submitFlagged(const Order& o, std::vector<Fill>* fills, uint64_t startTime) {
+    Order order = o;
+    bool buy = o.side == Side::Buy;
+    RejectReason reason = RejectReason::None;
+    
+    if (o.peg != PegType::None || o.minQty > o.quantity ||
+        (o.postOnly != PostOnly::None && (o.type != OrderType::Limit || o.tif == TimeInForce::IOC ||
+                                          o.tif == TimeInForce::FOK))) {
+        reason = RejectReason::InvalidOrderFlags;
+    } else {
+        if (o.reduceOnly) {
+            int64_t reducible = reducibleQuantity(o.ownerId, o.side);
+            if (reducible <= 0) {
+                reason = RejectReason::ReduceOnlyWouldIncrease;
+            } else if (reducible < order.quantity) {
+                order.quantity = static_cast<uint32_t>(reducible);
+            }
+        }
+        
+        int64_t contra = contraTouch(o.side);
+        bool crosses = buy ? o.priceTick >= contra : o.priceTick <= contra;
+        if (crosses && o.postOnly == PostOnly::Reject) {
+            reason = RejectReason::PostOnlyWouldCross;
+        } else if (crosses && o.postOnly == PostOnly::Reprice) {
+            order.priceTick = buy ? contra - 1 : contra + 1;
+            crosses = false;
+        }
+        
+        // Nothing executes unless the order crosses; otherwise the same walk as FOK
+        if (o.minQty != 0 && reason == RejectReason::None &&
+            (!crosses || order.quantity < o.minQty || !canFill(order, o.minQty))) {
+            reason = RejectReason::MinQtyNotFillable;
+        }
+    }
     
+    if (reason != RejectReason::None) {
+        publishReport(o, 0, ExecOutcome::Rejected, reason, 0, 0);
+        recordReject(o, reason);
+        return {};
+    }
+    return submitAccepted(order, fills, startTime);
+}
+
+void OrderBook::matchLoop(const Order& incomingOrder, uint64_t orderId, uint32_t& remaining, std::vector<Fill>* fills) {
+    // Contra pegs and implied liquidity priced inside the next displayed
+    // level trade ahead of it, at the level's price they trade behind it
+    ++pegEpoch_;
     if (incomingOrder.side == Side::Buy) {
         // Buy order: match against asks
-        auto it = contraLevels.begin();
-        while (remaining > 0 && it != contraLevels.end() && it->first <= incomingOrder.priceTick) {
-            auto& queue = it->second;
-            
-            while (remaining > 0 && !queue.empty()) {
-                Order* restingOrder = queue.front();
-                
-                // Prevent self-matching
-                if (UNLIKELY(restingOrder->ownerId == incomingOrder.ownerId)) {
-                    break;
-                }
-                
-                uint32_t fillQty = std::min(remaining, restingOrder->quantity);
-                
-                Fill fill{
-                    restingOrder->id,
-                    incomingOrder.id,
-                    fillQty,
-                    it->first,
-                    getCurrentTimeNs()
-                };
-                
-                if (fills) fills->push_back(fill);
-                if (fillCb_) fillCb_(fill);
-                
-                restingOrder->quantity -= fillQty;
-                remaining -= fillQty;
-                
-                if (restingOrder->quantity == 0) {
-                    orders_.erase(restingOrder->id);
-                    queue.pop_front();
-                }
-                
-                stats_.fillsGenerated.fetch_add(1, std::memory_order_relaxed);
+        auto it = asks_.begin();
+        while (remaining > 0 && it != asks_.end() && it->first <= incomingOrder.priceTick) {
+            if (UNLIKELY(implied_ != nullptr)) {
+                matchImplied(Side::Sell, it->first - 1, incomingOrder, orderId, remaining, fills);
+                if (remaining == 0) break;
+            }
+            if (UNLIKELY(pegBest_[1] < it->first)) {
+                matchPegs(Side::Sell, it->first - 1, incomingOrder, orderId, remaining, fills);
+                if (remaining == 0) break;
+            }
+            prefetchLevels(it, asks_.end());
+            matchLevel(it->second, it->first, incomingOrder, orderId, remaining, fills);
+            if (UNLIKELY(pegBest_[1] <= it->first)) {
+                matchPegs(Side::Sell, it->first, incomingOrder, orderId, remaining, fills);
+            }
+            if (UNLIKELY(implied_ != nullptr)) {
+                matchImplied(Side::Sell, it->first, incomingOrder, orderId, remaining, fills);
             }
             
-            if (queue.empty()) {
-                it = contraLevels.erase(it);
+            if (it->second.head == INVALID_SLOT) {
+                it = asks_.erase(it);
             } else {
                 ++it;
             }
         }
+        if (UNLIKELY(implied_ != nullptr)) {
+            matchImplied(Side::Sell, incomingOrder.priceTick, incomingOrder, orderId, remaining, fills);
+        }
+        if (UNLIKELY(pegBest_[1] <= incomingOrder.priceTick) && remaining > 0) {
+            matchPegs(Side::Sell, incomingOrder.priceTick, incomingOrder, orderId, remaining, fills);
+        }
+        refreshBestTick(Side::Sell);
     } else {
         // Sell order: match against bids (highest price first)
-        auto it = contraLevels.rbegin();
-        while (remaining > 0 && it != contraLevels.rend() && it->first >= incomingOrder.priceTick) {
-            auto& queue = it->second;
-            
-            while (remaining > 0 && !queue.empty()) {
-                Order* restingOrder = queue.front();
-                
-                if (UNLIKELY(restingOrder->ownerId == incomingOrder.ownerId)) {
-                    break;
-                }
-                
-                uint32_t fillQty = std::min(remaining, restingOrder->quantity);
-                
-                Fill fill{
-                    restingOrder->id,
-                    incomingOrder.id,
-                    fillQty,
-                    it->first,
-                    getCurrentTimeNs()
-                };
-                
-                if (fills) fills->push_back(fill);
-                if (fillCb_) fillCb_(fill);
-                
-                restingOrder->quantity -= fillQty;
-                remaining -= fillQty;
-                
-                if (restingOrder->quantity == 0) {
-                    orders_.erase(restingOrder->id);
-                    queue.pop_front();
-                }
-                
-                stats_.fillsGenerated.fetch_add(1, std::memory_order_relaxed);
+        auto it = bids_.rbegin();
+        while (remaining > 0 && it != bids_.rend() && it->first >= incomingOrder.priceTick) {
+            if (UNLIKELY(implied_ != nullptr)) {
+                matchImplied(Side::Buy, it->first + 1, incomingOrder, orderId, remaining, fills);
+                if (remaining == 0) break;
+            }
+            if (UNLIKELY(pegBest_[0] > it->first)) {
+                matchPegs(Side::Buy, it->first + 1, incomingOrder, orderId, remaining, fills);
+                if (remaining == 0) break;
+            }
+            prefetchLevels(it, bids_.rend());
+            matchLevel(it->second, it->first, incomingOrder, orderId, remaining, fills);
+            if (UNLIKELY(pegBest_[0] >= it->first)) {
+                matchPegs(Side::Buy, it->first, incomingOrder, orderId, remaining, fills);
+            }
+            if (UNLIKELY(implied_ != nullptr)) {
+                matchImplied(Side::Buy, it->first, incomingOrder, orderId, remaining, fills);
             }
             
-            if (queue.empty()) {
+            if (it->second.head == INVALID_SLOT) {
                 // Convert reverse iterator to forward iterator for erase
-                auto forward_it = std::next(it).base();
-                contraLevels.erase(forward_it);
-                // Restart iteration from the beginning
-                it = contraLevels.rbegin();
+                it = std::make_reverse_iterator(bids_.erase(std::next(it).base()));
             } else {
                 ++it;
             }
         }
+        if (UNLIKELY(implied_ != nullptr)) {
+            matchImplied(Side::Buy, incomingOrder.priceTick, incomingOrder, orderId, remaining, fills);
+        }
+        if (UNLIKELY(pegBest_[0] >= incomingOrder.priceTick) && remaining > 0) {
+            matchPegs(Side::Buy, incomingOrder.priceTick, incomingOrder, orderId, remaining, fills);
+        }
+        refreshBestTick(Side::Buy);
+    }
+}
+
+void OrderBook::matchImplied(Side side, int64_t throughPrice, const Order& incomingOrder,
+                             uint64_t orderId, uint32_t& remaining, std::vector<Fill>* fills) {
+    int64_t priceTick;
+    uint32_t available;
+    while (remaining > 0 && implied_->quote(*this, side, priceTick, available) &&
+           (side == Side::Sell ? priceTick <= throughPrice : priceTick >= throughPrice)) {
+        // Resting pegs at or inside the implied price keep priority over it
+        if (side == Side::Sell ? pegBest_[1] <= priceTick : pegBest_[0] >= priceTick) {
+            matchPegs(side, priceTick, incomingOrder, orderId, remaining, fills);
+            if (remaining == 0) break;
+        }
+        
+        uint32_t fillQty = implied_->execute(*this, side, std::min(remaining, available));
+        if (fillQty == 0) break;
+        
+        Fill fill{0, orderId, fillQty, priceTick, getCurrentTimeNs(),
+                  IMPLIED_OWNER_ID, incomingOrder.ownerId, 0, 0};
+        if (fees_) {
+            fill.takerFee = fees_->charge(incomingOrder.ownerId, incomingOrder.side, Liquidity::Taker,
+                                          priceTick, fillQty, fill.timestamp);
+        }
+        if (fills) fills->push_back(fill);
+        if (fillCb_) pendingFills_.push_back(fill);
+        
+        positions_.at(incomingOrder.ownerId) += incomingOrder.side == Side::Buy ? fillQty : -static_cast<int64_t>(fillQty);
+        remaining -= fillQty;
+        recordFill(fill);
+        
+        if (reports_) {
+            publishReport(incomingOrder, orderId, ExecOutcome::Trade, RejectReason::None,
+                          remaining, incomingOrder.quantity - remaining,
+                          fillQty, priceTick, fill.timestamp, OrderHandle(),
+                          Liquidity::Taker, fill.takerFee);
+        }
+    }
+}
+
+uint32_t OrderBook::fillImpliedLeg(Side takerSide, uint32_t quantity) {
+    // Only the displayed touch contributes to implied prices
+    Order taker{0, takerSide, 0, quantity, OrderType::Limit, TimeInForce::IOC, IMPLIED_OWNER_ID, 0};
+    uint32_t remaining = quantity;
+    if (takerSide == Side::Buy) {
+        if (asks_.empty()) return 0;
+        auto it = asks_.begin();
+        taker.priceTick = it->first;
+        matchLevel(it->second, it->first, taker, 0, remaining, nullptr);
+        if (it->second.head == INVALID_SLOT) asks_.erase(it);
+        refreshBestTick(Side::Sell);
+    } else {
+        if (bids_.empty()) return 0;
+        auto it = std::prev(bids_.end());
+        taker.priceTick = it->first;
+        matchLevel(it->second, it->first, taker, 0, remaining, nullptr);
+        if (it->second.head == INVALID_SLOT) bids_.erase(it);
+        refreshBestTick(Side::Buy);
+    }
+    return quantity - remaining;
+}
+
+template <typename LevelIt>
+void OrderBook::prefetchLevels(LevelIt it, LevelIt end) const {
+    if constexpr (PREFETCH_DISTANCE > 0) {
+        // Two-stage pipeline across levels: the next level's node was
+        // requested one level ago, so reading its head is cheap; request
+        // that head order now and the node of the level after it
+        if (++it == end) return;
+        PREFETCH(&pool_[it->second.head]);
+        if (++it == end) return;
+        PREFETCH(&it->second);
+    }
+}
+
+void OrderBook::matchLevel(PriceLevel& level, int64_t priceTick, const Order& incomingOrder,
+                           uint64_t orderId, uint32_t& remaining, std::vector<Fill>* fills) {
+    // Lookahead cursor PREFETCH_DISTANCE links past the head. It only starts
+    // when the order will sweep past the head, and advances one link per
+    // consumed order, so each hop reads a line that is already in flight.
+    uint32_t ahead = INVALID_SLOT;
+    if constexpr (PREFETCH_DISTANCE > 0) {
+        if (level.head != INVALID_SLOT && remaining > pool_[level.head].quantity) {
+            ahead = level.head;
+            for (uint32_t i = 0; i < PREFETCH_DISTANCE && ahead != INVALID_SLOT; ++i) {
+                ahead = pool_[ahead].next;
+                if (ahead != INVALID_SLOT) PREFETCH(&pool_[ahead]);
+            }
+        }
+    }
+    
+    while (remaining > 0 && level.head != INVALID_SLOT) {
+        uint32_t slot = level.head;
+        
+        // Prevent self-matching
+        if (UNLIKELY(pool_[slot].ownerId == incomingOrder.ownerId)) {
+            break;
+        }
+        
+        if (executeFill(level, slot, priceTick, incomingOrder, orderId, remaining, fills)) {
+            if constexpr (PREFETCH_DISTANCE > 0) {
+                if (ahead != INVALID_SLOT) {
+                    ahead = pool_[ahead].next;
+                    if (ahead != INVALID_SLOT) PREFETCH(&pool_[ahead]);
+                }
+            }
+        }
     }
 }
 
-void OrderBook::restOrder(const Order& order, uint32_t remaining) {
-    Order newOrder = order;
+bool OrderBook::executeFill(PriceLevel& level, uint32_t slot, int64_t priceTick, const Order& incomingOrder,
+                            uint64_t orderId, uint32_t& remaining, std::vector<Fill>* fills) {
+    auto& restingOrder = pool_[slot];
+    uint32_t fillQty = std::min(remaining, restingOrder.quantity);
+    
+    Fill fill{
+        restingOrder.orderId,
+        orderId,
+        fillQty,
+        priceTick,
+        getCurrentTimeNs(),
+        restingOrder.ownerId,
+        incomingOrder.ownerId,
+        0,
+        0
+    };
+    // The implied taker is synthetic: no fee, position or report of its own
+    bool impliedTaker = UNLIKELY(incomingOrder.ownerId == IMPLIED_OWNER_ID);
+    if (fees_) {
+        fill.makerFee = fees_->charge(restingOrder.ownerId, restingOrder.side, Liquidity::Maker,
+                                      priceTick, fillQty, fill.timestamp);
+        if (!impliedTaker) {
+            fill.takerFee = fees_->charge(incomingOrder.ownerId, incomingOrder.side, Liquidity::Taker,
+                                          priceTick, fillQty, fill.timestamp);
+        }
+    }
+    
+    if (fills) fills->push_back(fill);
+    if (fillCb_) pendingFills_.push_back(fill);
+    
+    int64_t makerDelta = restingOrder.side == Side::Buy ? fillQty : -static_cast<int64_t>(fillQty);
+    positions_.at(restingOrder.ownerId) += makerDelta;
+    if (!impliedTaker) positions_.at(incomingOrder.ownerId) -= makerDelta;
+    
+    restingOrder.quantity -= fillQty;
+    restingOrder.filledQty += fillQty;
+    adjustLevelQuantity(level, restingOrder, -static_cast<int64_t>(fillQty));
+    remaining -= fillQty;
+    recordFill(fill);
+    
+    if (reports_) {
+        OrderHandle makerHandle = restingOrder.quantity ? pool_.handle(slot) : OrderHandle();
+        publishReport(restingOrder, restingOrder.orderId, ExecOutcome::Trade,
+                      RejectReason::None, restingOrder.quantity, restingOrder.filledQty,
+                      fillQty, priceTick, fill.timestamp, makerHandle,
+                      Liquidity::Maker, fill.makerFee);
+        if (!impliedTaker) {
+            publishReport(incomingOrder, orderId, ExecOutcome::Trade, RejectReason::None,
+                          remaining, incomingOrder.quantity - remaining,
+                          fillQty, priceTick, fill.timestamp, OrderHandle(),
+                          Liquidity::Taker, fill.takerFee);
+        }
+    }
+    
+    if (restingOrder.quantity != 0) return false;
+    
+    unlinkFromLevel(level, slot);
+    clientIndex_.erase(restingOrder.ownerId, restingOrder.id);
+    orders_.erase(restingOrder.orderId);
+    if (UNLIKELY(restingOrder.peg != PegType::None)) {
+        pegOrders_[restingOrder.side == Side::Buy ? 0 : 1]--;
+    }
+    pool_.release(slot);
+    orderCount_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+uint32_t OrderBook::restOrder(const Order& order, uint64_t orderId, uint32_t remaining, uint32_t filled) {
+    uint32_t slot = pool_.allocate();
+    auto& newOrder = pool_[slot];
+    static_cast<Order&>(newOrder) = order;
     newOrder.quantity = remaining;
     newOrder.timestamp = getCurrentTimeNs();
+    newOrder.orderId = orderId;
+    newOrder.filledQty = filled;
     
-    orders_[order.id] = newOrder;
-    Order* orderPtr = &orders_[order.id];
+    orders_.emplace(orderId, slot);
+    clientIndex_.insert(order.ownerId, order.id, slot);
     
-    auto& levels = (order.side == Side::Buy) ? bids_ : asks_;
-    levels[order.priceTick].push_back(orderPtr);
+    appendToLevel(levelFor(order.side, order.priceTick), slot);
     
     orderCount_.fetch_add(1, std::memory_order_relaxed);
-    
-    // Update best price tracking
-    if (order.side == Side::Buy) {
-        int64_t currentBest = bestBidTick_.load(std::memory_order_relaxed);
-        while (order.priceTick > currentBest) {
-            if (bestBidTick_.compare_exchange_weak(currentBest, order.priceTick)) break;
+    return slot;
+}
+
+OrderBook::PriceLevel& OrderBook::levelFor(Side side, int64_t priceTick) {
+    // Joining or improving the touch is the common passive case: resolve it
+    // from the map ends (amortised O(1) hinted insert) before a tree search
+    if (side == Side::Buy) {
+        int64_t best = bestBidTick_.load(std::memory_order_relaxed);
+        if (priceTick == best) return bids_.rbegin()->second;
+        if (priceTick > best) {
+            bestBidTick_.store(priceTick, std::memory_order_relaxed);
+            PriceLevel& level = bids_.emplace_hint(bids_.end(), priceTick, PriceLevel())->second;
+            if (UNLIKELY(hasPegs())) repegIfMoved();
+            return level;
         }
+        return bids_[priceTick];
     } else {
-        int64_t currentBest = bestAskTick_.load(std::memory_order_relaxed);
-        while (order.priceTick < currentBest) {
-            if (bestAskTick_.compare_exchange_weak(currentBest, order.priceTick)) break;
+        int64_t best = bestAskTick_.load(std::memory_order_relaxed);
+        if (priceTick == best) return asks_.begin()->second;
+        if (priceTick < best) {
+            bestAskTick_.store(priceTick, std::memory_order_relaxed);
+            PriceLevel& level = asks_.emplace_hint(asks_.begin(), priceTick, PriceLevel())->second;
+            if (UNLIKELY(hasPegs())) repegIfMoved();
+            return level;
         }
+        return asks_[priceTick];
+    }
+}
+
+void OrderBook::adjustLevelQuantity(PriceLevel& level, const Order& order, int64_t delta) {
+    level.totalQuantity += static_cast<uint64_t>(delta);
+    if (order.peg != PegType::None) return;
+    if (order.priceTick == (order.side == Side::Buy ? bestBidTick_ : bestAskTick_).load(std::memory_order_relaxed)) {
+        ++topVersion_;
+    }
+    if (depthIndex_.enabled()) depthIndex_.add(order.side, order.priceTick, delta);
+}
+
+void OrderBook::refreshBestTick(Side side) {
+    if (side == Side::Buy) {
+        bestBidTick_.store(bids_.empty() ? INT64_MIN : bids_.rbegin()->first, std::memory_order_relaxed);
+    } else {
+        bestAskTick_.store(asks_.empty() ? INT64_MAX : asks_.begin()->first, std::memory_order_relaxed);
+    }
+    ++topVersion_;
+    if (UNLIKELY(hasPegs())) repegIfMoved();
+}
+
+void OrderBook::appendToLevel(PriceLevel& level, uint32_t slot) {
+    auto& order = pool_[slot];
+    order.prev = level.tail;
+    order.next = INVALID_SLOT;
+    
+    if (level.tail != INVALID_SLOT) {
+        pool_[level.tail].next = slot;
+    } else {
+        level.head = slot;
+    }
+    level.tail = slot;
+    level.count++;
+    adjustLevelQuantity(level, order, order.quantity);
+}
+
+void OrderBook::unlinkFromLevel(PriceLevel& level, uint32_t slot) {
+    auto& order = pool_[slot];
+    
+    if (order.prev != INVALID_SLOT) {
+        pool_[order.prev].next = order.next;
+    } else {
+        level.head = order.next;
+    }
+    if (order.next != INVALID_SLOT) {
+        pool_[order.next].prev = order.prev;
+    } else {
+        level.tail = order.prev;
     }
+    level.count--;
+    adjustLevelQuantity(level, order, -static_cast<int64_t>(order.quantity));
 }
 
-bool OrderBook::canFullyFill(const Order& order) const {
-    uint32_t needed = order.quantity;
+bool OrderBook::canFill(const Order& order, uint32_t quantity) const {
+    uint32_t needed = quantity;
     const auto& contraLevels = (order.side == Side::Buy) ? asks_ : bids_;
     
+    // Matching stops at the owner's own order and moves on to the next
+    // queue, so nothing queued behind it counts
+    auto countLevel = [&](const PriceLevel& level) {
+        for (uint32_t slot = level.head; slot != INVALID_SLOT; slot = pool_[slot].next) {
+            const auto& restingOrder = pool_[slot];
+            if (restingOrder.ownerId == order.ownerId) return false;
+            
+            if (restingOrder.quantity >= needed) return true;
+            needed -= restingOrder.quantity;
+        }
+        return false;
+    };
+    
     if (order.side == Side::Buy) {
-        for (const auto& [price, queue] : contraLevels) {
+        for (const auto& [price, level] : contraLevels) {
             if (price > order.priceTick) break;
-            
-            for (const Order* restingOrder : queue) {
-                if (restingOrder->ownerId == order.ownerId) continue;
-                
-                if (restingOrder->quantity >= needed) return true;
-                needed -= restingOrder->quantity;
-                if (needed == 0) return true;
-            }
+            if (countLevel(level)) return true;
         }
     } else {
         for (auto it = contraLevels.rbegin(); it != contraLevels.rend(); ++it) {
             if (it->first < order.priceTick) break;
-            
-            for (const Order* restingOrder : it->second) {
-                if (restingOrder->ownerId == order.ownerId) continue;
-                
-                if (restingOrder->quantity >= needed) return true;
-                needed -= restingOrder->quantity;
-                if (needed == 0) return true;
-            }
+            if (countLevel(it->second)) return true;
         }
     }
     
+    // Pegged liquidity the order would reach, in any price order
+    size_t contra = order.side == Side::Buy ? 1 : 0;
+    for (uint32_t index : activePegGroups_[contra]) {
+        const PegGroup& group = pegGroups_[contra][index];
+        if (!group.priced) continue;
+        if (order.side == Side::Buy ? group.priceTick > order.priceTick : group.priceTick < order.priceTick) continue;
+        if (countLevel(group.queue)) return true;
+    }
+    
+    // The current implied level; deeper implied depth is not known up front
+    int64_t impliedPrice;
+    uint32_t impliedQty;
+    if (UNLIKELY(implied_ != nullptr) &&
+        implied_->quote(*this, order.side == Side::Buy ? Side::Sell : Side::Buy, impliedPrice, impliedQty) &&
+        (order.side == Side::Buy ? impliedPrice <= order.priceTick : impliedPrice >= order.priceTick)) {
+        if (impliedQty >= needed) return true;
+        needed -= impliedQty;
+    }
+    
     return needed == 0;
 }
 
+int64_t OrderBook::contraTouch(Side side) const {
+    // Opposite touch including priced pegs and implied quotes; a sentinel
+    // when that side is empty
+    int64_t touch = side == Side::Buy ? std::min(bestAskTick_.load(std::memory_order_relaxed), pegBest_[1])
+                                      : std::max(bestBidTick_.load(std::memory_order_relaxed), pegBest_[0]);
+    int64_t impliedPrice;
+    uint32_t impliedQty;
+    if (UNLIKELY(implied_ != nullptr) &&
+        implied_->quote(*this, side == Side::Buy ? Side::Sell : Side::Buy, impliedPrice, impliedQty)) {
+        touch = side == Side::Buy ? std::min(touch, impliedPrice) : std::max(touch, impliedPrice);
+    }
+    return touch;
+}
+
+int64_t OrderBook::reducibleQuantity(uint32_t ownerId, Side side) const {
+    int64_t position = positions_.get(ownerId);
+    return side == Side::Buy ? -position : position;
+}
+
+int64_t OrderBook::getPosition(uint32_t ownerId) const {
+    std::lock_guard<BookLock> lock(lock_);
+    return positions_.get(ownerId);
+}
+
+void OrderBook::setPosition(uint32_t ownerId, int64_t position) {
+    std::lock_guard<BookLock> lock(lock_);
+    wakeLocked();
+    positions_.at(ownerId) = position;
+}
+
 double OrderBook::bestBid() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (bids_.empty()) return -1.0;
-    return bids_.rbegin()->first / double(TICK_PRECISION);
+    BestLevel level = getBestBidLevel();
+    if (!level.valid) return -1.0;
+    return level.priceTick / double(TICK_PRECISION);
 }
 
 double OrderBook::bestAsk() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (asks_.empty()) return -1.0;
-    return asks_.begin()->first / double(TICK_PRECISION);
+    BestLevel level = getBestAskLevel();
+    if (!level.valid) return -1.0;
+    return level.priceTick / double(TICK_PRECISION);
+}
+
+BestLevel OrderBook::bestLevel(Side side) const {
+    const auto& levels = (side == Side::Buy) ? bids_ : asks_;
+    if (levels.empty()) return {0, 0, 0, false};
+    
+    const auto& level = (side == Side::Buy) ? *levels.rbegin() : *levels.begin();
+    return {level.first, level.second.totalQuantity, level.second.count, true};
+}
+
+BestLevel OrderBook::getBestBidLevel() const {
+    std::lock_guard<BookLock> lock(lock_);
+    return bestLevel(Side::Buy);
+}
+
+BestLevel OrderBook::getBestAskLevel() const {
+    std::lock_guard<BookLock> lock(lock_);
+    return bestLevel(Side::Sell);
+}
+
+TopOfBook OrderBook::getTopOfBook() const {
+    std::lock_guard<BookLock> lock(lock_);
+    return {bestLevel(Side::Buy), bestLevel(Side::Sell)};
 }
 
 std::vector<LevelInfo> OrderBook::getTopLevels(Side side, size_t depth) const {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<BookLock> lock(lock_);
     std::vector<LevelInfo> result;
     result.reserve(depth);
     
@@ -223,124 +812,992 @@ std::vector<LevelInfo> OrderBook::getTopLevels(Side side, size_t depth) const {
     if (side == Side::Buy) {
         // Bids: highest price first
         for (auto it = levels.rbegin(); it != levels.rend() && result.size() < depth; ++it) {
-            uint64_t totalQty = 0;
-            for (const Order* order : it->second) {
-                totalQty += order->quantity;
-            }
-            result.push_back({
-                it->first,
-                totalQty,
-                static_cast<uint32_t>(it->second.size()),
-                0
-            });
+            result.push_back({it->first, it->second.totalQuantity, it->second.count, 0});
         }
     } else {
         // Asks: lowest price first
         for (auto it = levels.begin(); it != levels.end() && result.size() < depth; ++it) {
-            uint64_t totalQty = 0;
-            for (const Order* order : it->second) {
-                totalQty += order->quantity;
-            }
-            result.push_back({
-                it->first,
-                totalQty,
-                static_cast<uint32_t>(it->second.size()),
-                0
-            });
+            result.push_back({it->first, it->second.totalQuantity, it->second.count, 0});
         }
     }
     
     return result;
 }
 
-uint64_t OrderBook::getTotalVolume(Side side) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    uint64_t total = 0;
+void OrderBook::enableDepthIndex(int64_t baseTick, size_t numTicks) {
+    std::lock_guard<BookLock> lock(lock_);
+    depthIndex_.configure(baseTick, numTicks);
+    
+    for (const auto& [price, level] : bids_) {
+        depthIndex_.add(Side::Buy, price, static_cast<int64_t>(level.totalQuantity));
+    }
+    for (const auto& [price, level] : asks_) {
+        depthIndex_.add(Side::Sell, price, static_cast<int64_t>(level.totalQuantity));
+    }
+}
+
+uint64_t OrderBook::getDepthWithin(Side side, int64_t ticks) const {
+    std::lock_guard<BookLock> lock(lock_);
+    
     const auto& levels = (side == Side::Buy) ? bids_ : asks_;
+    if (levels.empty()) return 0;
+    
+    if (side == Side::Buy) {
+        int64_t limit = bids_.rbegin()->first - ticks;
+        if (depthIndex_.enabled() && depthIndex_.outsideQuantity(side) == 0) {
+            return depthIndex_.depthThrough(side, limit);
+        }
+        uint64_t total = 0;
+        for (auto it = bids_.rbegin(); it != bids_.rend() && it->first >= limit; ++it) {
+            total += it->second.totalQuantity;
+        }
+        return total;
+    } else {
+        int64_t limit = asks_.begin()->first + ticks;
+        if (depthIndex_.enabled() && depthIndex_.outsideQuantity(side) == 0) {
+            return depthIndex_.depthThrough(side, limit);
+        }
+        uint64_t total = 0;
+        for (auto it = asks_.begin(); it != asks_.end() && it->first <= limit; ++it) {
+            total += it->second.totalQuantity;
+        }
+        return total;
+    }
+}
+
+PriceImpact OrderBook::getPriceImpact(Side side, uint64_t quantity) const {
+    std::lock_guard<BookLock> lock(lock_);
     
-    for (const auto& [price, queue] : levels) {
-        for (const Order* order : queue) {
-            total += order->quantity;
+    DepthIndex::Sweep sweep{0, 0, 0};
+    if (depthIndex_.enabled() && depthIndex_.outsideQuantity(side) == 0) {
+        sweep = depthIndex_.sweep(side, quantity);
+    } else {
+        auto consume = [&](int64_t price, uint64_t levelQty) {
+            uint64_t take = std::min(quantity - sweep.quantity, levelQty);
+            sweep.quantity += take;
+            sweep.notional += (__int128)price * take;
+            sweep.worstPriceTick = price;
+            return sweep.quantity < quantity;
+        };
+        if (side == Side::Buy) {
+            for (auto it = bids_.rbegin(); it != bids_.rend() && consume(it->first, it->second.totalQuantity); ++it) {}
+        } else {
+            for (auto it = asks_.begin(); it != asks_.end() && consume(it->first, it->second.totalQuantity); ++it) {}
         }
     }
     
-    return total;
+    if (sweep.quantity == 0) return {0, 0, 0, quantity == 0};
+    return {
+        sweep.worstPriceTick,
+        divideRounded(sweep.notional * MID_PRECISION, sweep.quantity, Rounding::HalfEven),
+        sweep.quantity,
+        sweep.quantity == quantity
+    };
 }
 
-double OrderBook::getWeightedMidPrice() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (bids_.empty() || asks_.empty()) return -1.0;
+ExecutionEstimate OrderBook::estimateExecution(Side side, uint64_t quantity) const {
+    std::lock_guard<BookLock> lock(lock_);
+    ExecutionEstimate estimate;
+    estimateSorted(side, &quantity, 1, &estimate);
+    return estimate;
+}
+
+void OrderBook::estimateExecution(Side side, const std::vector<uint64_t>& sizes,
+                                  std::vector<ExecutionEstimate>& out) const {
+    out.resize(sizes.size());
+    if (std::is_sorted(sizes.begin(), sizes.end())) {
+        std::lock_guard<BookLock> lock(lock_);
+        estimateSorted(side, sizes.data(), sizes.size(), out.data());
+        return;
+    }
     
-    double bid = bids_.rbegin()->first / double(TICK_PRECISION);
-    double ask = asks_.begin()->first / double(TICK_PRECISION);
+    // Price an ascending copy, then scatter back to the caller's order
+    std::vector<size_t> order(sizes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sizes[a] < sizes[b]; });
+    std::vector<uint64_t> sorted(sizes.size());
+    for (size_t i = 0; i < order.size(); ++i) sorted[i] = sizes[order[i]];
     
-    // Get volumes at best levels
-    uint64_t bidVol = 0, askVol = 0;
-    for (const Order* order : bids_.rbegin()->second) {
-        bidVol += order->quantity;
+    std::vector<ExecutionEstimate> estimates(sizes.size());
+    {
+        std::lock_guard<BookLock> lock(lock_);
+        estimateSorted(side, sorted.data(), sorted.size(), estimates.data());
     }
-    for (const Order* order : asks_.begin()->second) {
-        askVol += order->quantity;
+    for (size_t i = 0; i < order.size(); ++i) out[order[i]] = estimates[i];
+}
+
+void OrderBook::estimateSorted(Side side, const uint64_t* sizes, size_t count,
+                               ExecutionEstimate* out) const {
+    // Running totals over fully consumed levels; each size is finished off
+    // against the level where it runs out, so the ladder is walked once.
+    uint64_t cumQty = 0;
+    __int128 cumNotional = 0;
+    uint32_t levels = 0;
+    int64_t lastPrice = 0;
+    size_t next = 0;
+    
+    auto finish = [&](uint64_t requested, uint64_t qty, __int128 notional, uint32_t touched, int64_t worst) {
+        ExecutionEstimate& e = out[next++];
+        e.fillableQty = qty;
+        e.levelsConsumed = touched;
+        e.worstPriceTick = qty ? worst : 0;
+        e.avgPriceSubTicks = qty ? divideRounded(notional * MID_PRECISION, qty, Rounding::HalfEven) : 0;
+        e.fillProbability = requested ? static_cast<double>(qty) / requested : 1.0;
+    };
+    
+    auto visit = [&](int64_t price, uint64_t levelQty) {
+        // Sizes that run out inside this level
+        while (next < count && sizes[next] <= cumQty + levelQty) {
+            uint64_t requested = sizes[next];
+            if (requested <= cumQty) {
+                // Only a zero size reaches here with ascending input
+                finish(requested, requested, cumNotional, levels, lastPrice);
+                continue;
+            }
+            finish(requested, requested, cumNotional + (__int128)price * (requested - cumQty),
+                   levels + 1, price);
+        }
+        cumQty += levelQty;
+        cumNotional += (__int128)price * levelQty;
+        levels++;
+        lastPrice = price;
+        return next < count;
+    };
+    
+    if (side == Side::Buy) {
+        for (auto it = asks_.begin(); it != asks_.end() && visit(it->first, it->second.totalQuantity); ++it) {}
+    } else {
+        for (auto it = bids_.rbegin(); it != bids_.rend() && visit(it->first, it->second.totalQuantity); ++it) {}
     }
     
-    if (bidVol + askVol == 0) return (bid + ask) / 2.0;
-    return (bid * askVol + ask * bidVol) / (bidVol + askVol);
+    // Sizes beyond the visible book take whatever is there
+    while (next < count) {
+        finish(sizes[next], cumQty, cumNotional, levels, lastPrice);
+    }
+}
+
+bool OrderBook::writeSnapshot(int fd) const {
+    std::lock_guard<BookLock> lock(lock_);
+    FdWriter out(fd);
+    return serializeTo(out);
 }
 
-bool OrderBook::cancelOrder(uint64_t orderId) {
-    std::lock_guard<std::mutex> lock(mutex_);
+bool OrderBook::writeSnapshot(std::vector<char>& out) const {
+    std::lock_guard<BookLock> lock(lock_);
+    VectorWriter writer(out);
+    out.reserve(sizeof(SnapshotHeader) + orderCount_.load(std::memory_order_relaxed) * sizeof(SnapshotRecord) +
+                positions_.size() * sizeof(SnapshotPosition));
+    return serializeTo(writer);
+}
+
+pid_t OrderBook::forkSnapshot(const char* path) {
+    pid_t pid;
+    {
+        std::lock_guard<BookLock> lock(lock_);
+        uint64_t start = getCurrentTimeNs();
+        pid = ::fork();
+        if (pid == 0) {
+            // Child: only async-signal-safe calls from here on
+            int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            bool ok = false;
+            if (fd >= 0) {
+                FdWriter out(fd);
+                ok = serializeTo(out) && ::fsync(fd) == 0;
+            }
+            if (fd >= 0) ::close(fd);
+            ::_exit(ok ? 0 : 1);
+        }
+        stats_.lastSnapshotPauseNs.store(getCurrentTimeNs() - start, std::memory_order_relaxed);
+    }
+    if (pid > 0) stats_.snapshotsTaken.fetch_add(1, std::memory_order_relaxed);
+    return pid;
+}
+
+template<typename Writer>
+bool OrderBook::serializeTo(Writer& out) const {
+    if (UNLIKELY(hibernated_)) {
+        out.put(hibernateImage_.data(), hibernateImage_.size());
+        return out.flush();
+    }
     
-    auto it = orders_.find(orderId);
-    if (it == orders_.end()) return false;
+    // Flat positions are left out
+    uint64_t positionCount = 0;
+    positions_.forEach([&](uint32_t, int64_t position) { positionCount += position != 0; });
     
-    const Order& order = it->second;
-    auto& levels = (order.side == Side::Buy) ? bids_ : asks_;
+    SnapshotHeader header{SNAPSHOT_MAGIC, SNAPSHOT_VERSION, nextOrderId_,
+                          orderCount_.load(std::memory_order_relaxed), positionCount};
+    out.put(&header, sizeof(header));
     
-    auto levelIt = levels.find(order.priceTick);
-    if (levelIt != levels.end()) {
-        auto& queue = levelIt->second;
-        queue.erase(std::remove_if(queue.begin(), queue.end(),
-                       [orderId](const Order* o) { return o->id == orderId; }),
-                   queue.end());
+    // Levels in priority order so a reload rebuilds identical queues
+    auto writeLevel = [&](const PriceLevel& level) {
+        for (uint32_t slot = level.head; slot != INVALID_SLOT; slot = pool_[slot].next) {
+            const auto& order = pool_[slot];
+            SnapshotRecord record{order.orderId, order.id, order.priceTick, order.timestamp,
+                                  order.quantity, order.filledQty, order.ownerId,
+                                  static_cast<uint8_t>(order.side), static_cast<uint8_t>(order.type),
+                                  static_cast<uint8_t>(order.tif), static_cast<uint8_t>(order.peg),
+                                  order.pegOffset, static_cast<uint8_t>(order.postOnly),
+                                  order.reduceOnly, 0};
+            out.put(&record, sizeof(record));
+        }
+    };
+    for (auto it = bids_.rbegin(); it != bids_.rend(); ++it) writeLevel(it->second);
+    for (auto it = asks_.begin(); it != asks_.end(); ++it) writeLevel(it->second);
+    for (const auto& groups : pegGroups_) {
+        for (const auto& group : groups) writeLevel(group.queue);
+    }
+    
+    positions_.forEach([&](uint32_t ownerId, int64_t position) {
+        if (position == 0) return;
+        SnapshotPosition record{ownerId, 0, position};
+        out.put(&record, sizeof(record));
+    });
+    
+    return out.flush();
+}
+
+bool OrderBook::loadSnapshot(int fd) {
+    FdReader in(fd);
+    return deserializeFrom(in);
+}
+
+bool OrderBook::loadSnapshot(const char* data, size_t size) {
+    MemoryReader in(data, size);
+    return deserializeFrom(in);
+}
+
+template<typename Reader>
+bool OrderBook::deserializeFrom(Reader& in) {
+    std::lock_guard<BookLock> lock(lock_);
+    return deserializeLocked(in);
+}
+
+template<typename Reader>
+bool OrderBook::deserializeLocked(Reader& in) {
+    SnapshotHeader header;
+    if (!in.get(&header, sizeof(header)) ||
+        header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION) {
+        return false;
+    }
+    clearLocked();
+    
+    for (uint64_t i = 0; i < header.orderCount; ++i) {
+        SnapshotRecord record;
+        if (!in.get(&record, sizeof(record))) {
+            clearLocked();
+            return false;
+        }
+        Order order{record.clientOrderId, static_cast<Side>(record.side), record.priceTick,
+                    record.quantity, static_cast<OrderType>(record.type),
+                    static_cast<TimeInForce>(record.tif), record.ownerId, record.timestamp,
+                    static_cast<PegType>(record.peg), record.pegOffset,
+                    static_cast<PostOnly>(record.postOnly), record.reduceOnly != 0};
+        uint32_t slot = order.peg == PegType::None
+            ? restOrder(order, record.orderId, record.quantity, record.filledQty)
+            : restPeg(order, record.orderId, record.quantity, record.filledQty);
+        pool_[slot].timestamp = record.timestamp;
+    }
+    
+    positions_.clear();
+    for (uint64_t i = 0; i < header.positionCount; ++i) {
+        SnapshotPosition record;
+        if (!in.get(&record, sizeof(record))) {
+            clearLocked();
+            positions_.clear();
+            return false;
+        }
+        positions_.at(record.ownerId) = record.position;
+    }
+    nextOrderId_ = header.nextOrderId;
+    repricePegs();
+    return true;
+}
+
+void OrderBook::clearLocked() {
+    for (auto* levels : {&bids_, &asks_}) {
+        for (const auto& [price, level] : *levels) {
+            for (uint32_t slot = level.head; slot != INVALID_SLOT;) {
+                uint32_t next = pool_[slot].next;
+                pool_.release(slot);
+                slot = next;
+            }
+        }
+        levels->clear();
+    }
+    for (auto& groups : pegGroups_) {
+        for (const auto& group : groups) {
+            for (uint32_t slot = group.queue.head; slot != INVALID_SLOT;) {
+                uint32_t next = pool_[slot].next;
+                pool_.release(slot);
+                slot = next;
+            }
+        }
+        groups.clear();
+    }
+    for (auto& active : activePegGroups_) active.clear();
+    for (auto& free : freePegGroups_) free.clear();
+    pegOrders_[0] = pegOrders_[1] = 0;
+    pegBest_[0] = INT64_MIN;
+    pegBest_[1] = INT64_MAX;
+    orders_.clear();
+    clientIndex_.clear();
+    if (depthIndex_.enabled()) depthIndex_.clear();
+    bestBidTick_.store(INT64_MIN, std::memory_order_relaxed);
+    bestAskTick_.store(INT64_MAX, std::memory_order_relaxed);
+    orderCount_.store(0, std::memory_order_relaxed);
+    hibernated_ = false;
+    std::vector<char>().swap(hibernateImage_);
+    ++topVersion_;
+}
+
+bool OrderBook::hibernate() {
+    std::lock_guard<BookLock> lock(lock_);
+    if (hibernated_) return true;
+    if (implied_) return false;
+    
+    std::vector<char> image;
+    VectorWriter writer(image);
+    image.reserve(sizeof(SnapshotHeader) + orderCount_.load(std::memory_order_relaxed) * sizeof(SnapshotRecord));
+    if (!serializeTo(writer)) return false;
+    
+    // Only the orders go. Level aggregates, the depth index, the best ticks
+    // and the order count stay, so market data reads still see the book;
+    // the emptied queues are never walked until revive clears them.
+    for (auto* levels : {&bids_, &asks_}) {
+        for (auto& [price, level] : *levels) level.head = level.tail = INVALID_SLOT;
+    }
+    for (size_t s = 0; s < 2; ++s) {
+        std::vector<PegGroup>().swap(pegGroups_[s]);
+        std::vector<uint32_t>().swap(activePegGroups_[s]);
+        std::vector<uint32_t>().swap(freePegGroups_[s]);
+    }
+    pegOrders_[0] = pegOrders_[1] = 0;
+    pegBest_[0] = INT64_MIN;
+    pegBest_[1] = INT64_MAX;
+    pool_.reset(COMPACT_BOOK_ORDERS);
+    OrderIdMap(orders_.get_allocator()).swap(orders_);
+    clientIndex_ = ClientOrderIndex(COMPACT_BOOK_ORDERS);
+    std::vector<Fill>().swap(pendingFills_);
+    
+    hibernateImage_.swap(image);
+    hibernated_ = true;
+    return true;
+}
+
+bool OrderBook::revive() {
+    std::lock_guard<BookLock> lock(lock_);
+    return reviveLocked();
+}
+
+bool OrderBook::isHibernated() const {
+    std::lock_guard<BookLock> lock(lock_);
+    return hibernated_;
+}
+
+bool OrderBook::reviveLocked() {
+    if (!hibernated_) return true;
+    // Moved out first: reloading clears the book, image included
+    std::vector<char> image;
+    image.swap(hibernateImage_);
+    MemoryReader in(image.data(), image.size());
+    return deserializeLocked(in);
+}
+
+uint64_t OrderBook::getTotalVolume(Side side) const {
+    std::lock_guard<BookLock> lock(lock_);
+    uint64_t total = 0;
+    const auto& levels = (side == Side::Buy) ? bids_ : asks_;
+    
+    for (const auto& [price, level] : levels) {
+        total += level.totalQuantity;
+    }
+    
+    return total;
+}
+
+MemoryUsage OrderBook::memoryUsage() const {
+    std::lock_guard<BookLock> lock(lock_);
+    MemoryUsage usage{};
+    usage.object = sizeof(OrderBook);
+    usage.orderStorage = pool_.memoryBytes();
+    usage.idIndex = orderIdBytes_ + clientIndex_.memoryBytes();
+    usage.levels = levelBytes_;
+    usage.queues = (pegGroups_[0].capacity() + pegGroups_[1].capacity()) * sizeof(PegGroup) +
+                   (activePegGroups_[0].capacity() + activePegGroups_[1].capacity() +
+                    freePegGroups_[0].capacity() + freePegGroups_[1].capacity()) * sizeof(uint32_t) +
+                   pendingFills_.capacity() * sizeof(Fill);
+    usage.rings = reports_ ? sizeof(ExecutionReportRing) + reports_->memoryBytes() : 0;
+    usage.depthIndex = depthIndex_.memoryBytes();
+    usage.positions = positions_.memoryBytes();
+    usage.hibernated = hibernateImage_.capacity();
+    usage.restingOrders = orderCount_.load(std::memory_order_relaxed);
+    return usage;
+}
+
+double OrderBook::getWeightedMidPrice() const {
+    WeightedMid mid = getWeightedMid(Rounding::HalfEven);
+    if (!mid.valid) return -1.0;
+    return mid.subTicks / double(MID_PRECISION * TICK_PRECISION);
+}
+
+WeightedMid OrderBook::getWeightedMid(Rounding rounding) const {
+    std::lock_guard<BookLock> lock(lock_);
+    return computeWeightedMid(bestLevel(Side::Buy), bestLevel(Side::Sell), rounding);
+}
+
+WeightedMid OrderBook::computeWeightedMid(const BestLevel& bid, const BestLevel& ask, Rounding rounding) {
+    if (!bid.valid || !ask.valid) return {0, false};
+    
+    // mid = (bid * askVol + ask * bidVol) / (bidVol + askVol), scaled to sub-ticks.
+    // 128-bit intermediates: tick * volume * MID_PRECISION overflows int64.
+    __int128 num, den;
+    if (bid.totalQuantity + ask.totalQuantity == 0) {
+        num = (__int128)(bid.priceTick + ask.priceTick) * MID_PRECISION;
+        den = 2;
+    } else {
+        num = ((__int128)bid.priceTick * ask.totalQuantity +
+               (__int128)ask.priceTick * bid.totalQuantity) * MID_PRECISION;
+        den = (__int128)bid.totalQuantity + ask.totalQuantity;
+    }
+    
+    return {divideRounded(num, den, rounding), true};
+}
+
+bool OrderBook::cancelByEngineId(uint64_t orderId) {
+    FillDispatch dispatch;
+    {
+        std::lock_guard<BookLock> lock(lock_);
+        wakeLocked();
         
-        if (queue.empty()) {
+        auto it = orders_.find(orderId);
+        if (it == orders_.end()) {
+            if (reports_) {
+                Order unknown{};
+                publishReport(unknown, orderId, ExecOutcome::CancelRejected, RejectReason::UnknownOrder, 0, 0);
+            }
+            return false;
+        }
+        
+        // A touch move can re-peg resting pegs into each other
+        removeOrder(it->second);
+        stageFills(dispatch);
+    }
+    dispatchFills(dispatch);
+    return true;
+}
+
+bool OrderBook::cancelOrder(uint32_t ownerId, uint64_t clientOrderId) {
+    FillDispatch dispatch;
+    {
+        std::lock_guard<BookLock> lock(lock_);
+        wakeLocked();
+        
+        uint32_t slot = clientIndex_.find(ownerId, clientOrderId);
+        if (slot == ClientOrderIndex::NOT_FOUND) {
+            if (reports_) {
+                Order unknown{};
+                unknown.id = clientOrderId;
+                unknown.ownerId = ownerId;
+                publishReport(unknown, 0, ExecOutcome::CancelRejected, RejectReason::UnknownOrder, 0, 0);
+            }
+            return false;
+        }
+        
+        removeOrder(slot);
+        stageFills(dispatch);
+    }
+    dispatchFills(dispatch);
+    return true;
+}
+
+void OrderBook::removeOrder(uint32_t slot) {
+    auto& order = pool_[slot];
+    
+    if (UNLIKELY(order.peg != PegType::None)) {
+        unlinkPeg(slot);
+    } else {
+        auto& levels = (order.side == Side::Buy) ? bids_ : asks_;
+        auto levelIt = levels.find(order.priceTick);
+        unlinkFromLevel(levelIt->second, slot);
+        if (levelIt->second.head == INVALID_SLOT) {
             levels.erase(levelIt);
+            refreshBestTick(order.side);
         }
     }
     
-    orders_.erase(it);
+    publishReport(order, order.orderId, ExecOutcome::Cancelled, RejectReason::None, 0, order.filledQty);
+    clientIndex_.erase(order.ownerId, order.id);
+    orders_.erase(order.orderId);
+    pool_.release(slot);
     orderCount_.fetch_sub(1, std::memory_order_relaxed);
-    return true;
 }
 
-std::vector<Fill> OrderBook::modifyOrder(uint64_t orderId, int64_t newPrice, uint32_t newQty) {
+std::vector<Fill> OrderBook::modifyByEngineId(uint64_t orderId, int64_t newPrice, uint32_t newQty) {
     std::vector<Fill> fills;
-    
-    // Find the order first
-    Order originalOrder;
-    bool found = false;
-    
+    FillDispatch dispatch;
     {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<BookLock> lock(lock_);
+        wakeLocked();
+        
         auto it = orders_.find(orderId);
-        if (it != orders_.end()) {
-            originalOrder = it->second;
-            found = true;
+        if (it == orders_.end()) {
+            if (reports_) {
+                Order unknown{};
+                publishReport(unknown, orderId, ExecOutcome::ReplaceRejected, RejectReason::UnknownOrder, 0, 0);
+            }
+            return fills;
+        }
+        
+        amendSlot(it->second, newPrice, newQty, &fills);
+        stageFills(dispatch);
+    }
+    dispatchFills(dispatch);
+    return fills;
+}
+
+std::vector<Fill> OrderBook::modifyOrder(uint32_t ownerId, uint64_t clientOrderId, int64_t newPrice, uint32_t newQty) {
+    std::vector<Fill> fills;
+    FillDispatch dispatch;
+    {
+        std::lock_guard<BookLock> lock(lock_);
+        wakeLocked();
+        
+        uint32_t slot = clientIndex_.find(ownerId, clientOrderId);
+        if (slot == ClientOrderIndex::NOT_FOUND) {
+            if (reports_) {
+                Order unknown{};
+                unknown.id = clientOrderId;
+                unknown.ownerId = ownerId;
+                publishReport(unknown, 0, ExecOutcome::ReplaceRejected, RejectReason::UnknownOrder, 0, 0);
+            }
+            return fills;
+        }
+        
+        amendSlot(slot, newPrice, newQty, &fills);
+        stageFills(dispatch);
+    }
+    dispatchFills(dispatch);
+    return fills;
+}
+
+bool OrderBook::cancel(OrderHandle handle) {
+    FillDispatch dispatch;
+    {
+        std::lock_guard<BookLock> lock(lock_);
+        
+        uint32_t slot = pool_.resolve(handle);
+        if (UNLIKELY(slot == INVALID_SLOT)) {
+            if (reports_) {
+                Order unknown{};
+                publishReport(unknown, 0, ExecOutcome::CancelRejected, RejectReason::UnknownOrder, 0, 0);
+            }
+            return false;
+        }
+        
+        removeOrder(slot);
+        stageFills(dispatch);
+    }
+    dispatchFills(dispatch);
+    return true;
+}
+
+bool OrderBook::amend(OrderHandle handle, int64_t newPrice, uint32_t newQty, std::vector<Fill>* fills) {
+    FillDispatch dispatch;
+    bool amended;
+    {
+        std::lock_guard<BookLock> lock(lock_);
+        
+        uint32_t slot = pool_.resolve(handle);
+        if (UNLIKELY(slot == INVALID_SLOT)) {
+            if (reports_) {
+                Order unknown{};
+                publishReport(unknown, 0, ExecOutcome::ReplaceRejected, RejectReason::UnknownOrder, 0, 0);
+            }
+            return false;
+        }
+        
+        amended = amendSlot(slot, newPrice, newQty, fills);
+        stageFills(dispatch);
+    }
+    dispatchFills(dispatch);
+    return amended;
+}
+
+bool OrderBook::isResting(OrderHandle handle) const {
+    std::lock_guard<BookLock> lock(lock_);
+    return pool_.resolve(handle) != INVALID_SLOT;
+}
+
+uint64_t OrderBook::getEngineOrderId(OrderHandle handle) const {
+    std::lock_guard<BookLock> lock(lock_);
+    uint32_t slot = pool_.resolve(handle);
+    return slot == INVALID_SLOT ? 0 : pool_[slot].orderId;
+}
+
+bool OrderBook::amendSlot(uint32_t slot, int64_t newPrice, uint32_t newQty, std::vector<Fill>* fills) {
+    auto& order = pool_[slot];
+    
+    if (UNLIKELY(newQty == 0)) {
+        publishReport(order, order.orderId, ExecOutcome::ReplaceRejected, RejectReason::InvalidQuantity,
+                      order.quantity, order.filledQty, 0, 0, 0, pool_.handle(slot));
+        return false;
+    }
+    
+    if (UNLIKELY(order.peg != PegType::None)) {
+        return amendPeg(slot, newPrice, newQty);
+    }
+    
+    // Resting flags hold across amends: reduce-only caps size increases at
+    // the position, post-only rejects or reprices a crossing price
+    if (UNLIKELY(order.postOnly != PostOnly::None || order.reduceOnly)) {
+        if (order.reduceOnly && newQty > order.quantity) {
+            int64_t reducible = reducibleQuantity(order.ownerId, order.side);
+            newQty = static_cast<uint32_t>(std::max<int64_t>(order.quantity, std::min<int64_t>(newQty, reducible)));
+        }
+        int64_t contra = contraTouch(order.side);
+        if (order.postOnly != PostOnly::None &&
+            (order.side == Side::Buy ? newPrice >= contra : newPrice <= contra)) {
+            if (order.postOnly == PostOnly::Reject) {
+                publishReport(order, order.orderId, ExecOutcome::ReplaceRejected, RejectReason::PostOnlyWouldCross,
+                              order.quantity, order.filledQty, 0, 0, 0, pool_.handle(slot));
+                return false;
+            }
+            newPrice = order.side == Side::Buy ? contra - 1 : contra + 1;
         }
     }
     
-    if (found) {
-        // Cancel and resubmit without nested locking
-        cancelOrder(orderId);
+    auto& levels = (order.side == Side::Buy) ? bids_ : asks_;
+    auto levelIt = levels.find(order.priceTick);
+    
+    // Same-price size reduction keeps queue priority
+    if (newPrice == order.priceTick && newQty <= order.quantity) {
+        adjustLevelQuantity(levelIt->second, order, static_cast<int64_t>(newQty) - order.quantity);
+        order.quantity = newQty;
+        publishReport(order, order.orderId, ExecOutcome::Replaced, RejectReason::None,
+                      order.quantity, order.filledQty, 0, 0, 0, pool_.handle(slot));
+        return true;
+    }
+    
+    // Otherwise leave the level and re-enter as an aggressor at the new price
+    unlinkFromLevel(levelIt->second, slot);
+    if (levelIt->second.head == INVALID_SLOT) {
+        levels.erase(levelIt);
+        refreshBestTick(order.side);
+    }
+    
+    // Incoming quantity includes prior fills so Trade reports keep a running cum
+    Order incoming = order;
+    incoming.priceTick = newPrice;
+    incoming.quantity = newQty + order.filledQty;
+    uint32_t remaining = newQty;
+    matchLoop(incoming, order.orderId, remaining, fills);
+    
+    auto& amended = pool_[slot];
+    amended.filledQty = incoming.quantity - remaining;
+    
+    if (remaining == 0) {
+        publishReport(amended, amended.orderId, ExecOutcome::Filled, RejectReason::None,
+                      0, amended.filledQty);
+        clientIndex_.erase(amended.ownerId, amended.id);
+        orders_.erase(amended.orderId);
+        pool_.release(slot);
+        orderCount_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    
+    amended.priceTick = newPrice;
+    amended.quantity = remaining;
+    amended.timestamp = getCurrentTimeNs();
+    appendToLevel(levelFor(amended.side, newPrice), slot);
+    publishReport(amended, amended.orderId, ExecOutcome::Replaced, RejectReason::None,
+                  amended.quantity, amended.filledQty, 0, 0, 0, pool_.handle(slot));
+    return true;
+}
+
+OrderHandle OrderBook::submitPeg(const Order& o, std::vector<Fill>* fills, uint64_t startTime) {
+    // Groups are only kept current while pegs rest; bring them up to date
+    repegIfMoved();
+    
+    // Enter as a limit at the current peg price, then rest in the group
+    Order entry = o;
+    bool priced = pegPrice(o.side, o.peg, o.pegOffset, entry.priceTick);
+    if (UNLIKELY(o.tif == TimeInForce::FOK && (!priced || !canFill(entry, entry.quantity)))) {
+        publishReport(o, 0, ExecOutcome::FokRejected, RejectReason::FokNotFillable, 0, 0);
+        return {};
+    }
+    
+    uint64_t orderId = nextOrderId_++;
+    uint32_t remaining = o.quantity;
+    if (priced) matchLoop(entry, orderId, remaining, fills);
+    uint32_t filled = o.quantity - remaining;
+    OrderHandle handle;
+    
+    if (remaining > 0) {
+        if (UNLIKELY(o.tif == TimeInForce::IOC || o.tif == TimeInForce::FOK)) {
+            publishReport(entry, orderId, ExecOutcome::IocCancelled, RejectReason::None, 0, filled);
+            return {};
+        }
+        handle = pool_.handle(restPeg(o, orderId, remaining, filled));
+        publishReport(entry, orderId, filled ? ExecOutcome::PartiallyFilled : ExecOutcome::Rested,
+                      RejectReason::None, remaining, filled, 0, 0, 0, handle);
         
-        Order modifiedOrder = originalOrder;
-        modifiedOrder.priceTick = newPrice;
-        modifiedOrder.quantity = newQty;
+        // Its own sweep may have moved the reference past opposite pegs
+        uncrossPegs();
+    } else {
+        publishReport(entry, orderId, ExecOutcome::Filled, RejectReason::None, 0, filled);
+    }
+    
+    recordOrder(startTime, false);
+    return handle;
+}
+
+uint32_t OrderBook::restPeg(const Order& order, uint64_t orderId, uint32_t remaining, uint32_t filled) {
+    size_t s = order.side == Side::Buy ? 0 : 1;
+    uint32_t group = pegGroupFor(order.side, order.peg, order.pegOffset);
+    
+    uint32_t slot = pool_.allocate();
+    auto& newOrder = pool_[slot];
+    static_cast<Order&>(newOrder) = order;
+    newOrder.quantity = remaining;
+    newOrder.timestamp = getCurrentTimeNs();
+    newOrder.orderId = orderId;
+    newOrder.filledQty = filled;
+    newOrder.pegGroup = group;
+    
+    orders_.emplace(orderId, slot);
+    clientIndex_.insert(order.ownerId, order.id, slot);
+    
+    PegGroup& g = pegGroups_[s][group];
+    appendToLevel(g.queue, slot);
+    pegOrders_[s]++;
+    if (g.priced) {
+        pegBest_[s] = s == 0 ? std::max(pegBest_[s], g.priceTick) : std::min(pegBest_[s], g.priceTick);
+    }
+    
+    orderCount_.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+}
+
+void OrderBook::unlinkPeg(uint32_t slot) {
+    auto& order = pool_[slot];
+    size_t s = order.side == Side::Buy ? 0 : 1;
+    PegGroup& g = pegGroups_[s][order.pegGroup];
+    
+    unlinkFromLevel(g.queue, slot);
+    pegOrders_[s]--;
+    if (g.queue.head == INVALID_SLOT) refreshPegBest(order.side);
+}
+
+bool OrderBook::amendPeg(uint32_t slot, int64_t newPrice, uint32_t newQty) {
+    auto& order = pool_[slot];
+    PegGroup& g = pegGroups_[order.side == Side::Buy ? 0 : 1][order.pegGroup];
+    
+    // The peg sets the price; a different one would silently be ignored
+    if (UNLIKELY(newPrice != order.priceTick)) {
+        publishReport(order, order.orderId, ExecOutcome::ReplaceRejected, RejectReason::PegPriceNotAmendable,
+                      order.quantity, order.filledQty, 0, 0, 0, pool_.handle(slot));
+        return false;
+    }
+    
+    if (newQty > order.quantity) {
+        // A size increase goes to the back of the group
+        unlinkFromLevel(g.queue, slot);
+        order.quantity = newQty;
+        order.timestamp = getCurrentTimeNs();
+        appendToLevel(g.queue, slot);
+    } else {
+        adjustLevelQuantity(g.queue, order, static_cast<int64_t>(newQty) - order.quantity);
+        order.quantity = newQty;
+    }
+    
+    publishReport(order, order.orderId, ExecOutcome::Replaced, RejectReason::None,
+                  order.quantity, order.filledQty, 0, 0, 0, pool_.handle(slot));
+    return true;
+}
+
+void OrderBook::matchPegs(Side side, int64_t throughPrice, const Order& incomingOrder,
+                          uint64_t orderId, uint32_t& remaining, std::vector<Fill>* fills) {
+    bool emptied = false;
+    while (remaining > 0) {
+        PegGroup* group = nextPegGroup(side, throughPrice);
+        if (!group) break;
         
-        submitOrder(modifiedOrder, &fills);
+        uint32_t slot = group->queue.head;
+        if (UNLIKELY(pool_[slot].ownerId == incomingOrder.ownerId)) {
+            group->skipEpoch = pegEpoch_;
+            continue;
+        }
+        executeFill(group->queue, slot, group->priceTick, incomingOrder, orderId, remaining, fills);
+        emptied |= group->queue.head == INVALID_SLOT;
+    }
+    if (emptied) refreshPegBest(side);
+}
+
+OrderBook::PegGroup* OrderBook::nextPegGroup(Side side, int64_t throughPrice) {
+    // Best price first; across groups at one price the oldest head goes first
+    bool buy = side == Side::Buy;
+    PegGroup* best = nullptr;
+    size_t s = buy ? 0 : 1;
+    for (uint32_t index : activePegGroups_[s]) {
+        PegGroup& g = pegGroups_[s][index];
+        if (g.queue.head == INVALID_SLOT || !g.priced || g.skipEpoch == pegEpoch_) continue;
+        if (buy ? g.priceTick < throughPrice : g.priceTick > throughPrice) continue;
+        if (!best || (buy ? g.priceTick > best->priceTick : g.priceTick < best->priceTick) ||
+            (g.priceTick == best->priceTick &&
+             pool_[g.queue.head].timestamp < pool_[best->queue.head].timestamp)) {
+            best = &g;
+        }
+    }
+    return best;
+}
+
+uint32_t OrderBook::pegGroupFor(Side side, PegType type, int32_t offset) {
+    size_t s = side == Side::Buy ? 0 : 1;
+    auto& groups = pegGroups_[s];
+    for (uint32_t index : activePegGroups_[s]) {
+        if (groups[index].type == type && groups[index].offset == offset) return index;
     }
     
-    return fills;
+    PegGroup group;
+    group.type = type;
+    group.offset = offset;
+    group.priced = pegPrice(side, type, offset, group.priceTick);
+    
+    uint32_t index;
+    if (!freePegGroups_[s].empty()) {
+        index = freePegGroups_[s].back();
+        freePegGroups_[s].pop_back();
+        groups[index] = group;
+    } else {
+        index = static_cast<uint32_t>(groups.size());
+        groups.push_back(group);
+    }
+    activePegGroups_[s].push_back(index);
+    return index;
+}
+
+bool OrderBook::pegPrice(Side side, PegType type, int32_t offset, int64_t& price) const {
+    int64_t bid = bestBidTick_.load(std::memory_order_relaxed);
+    int64_t ask = bestAskTick_.load(std::memory_order_relaxed);
+    bool hasBid = bid != INT64_MIN;
+    bool hasAsk = ask != INT64_MAX;
+    bool buy = side == Side::Buy;
+    
+    int64_t reference;
+    switch (type) {
+        case PegType::Primary:
+            if (!(buy ? hasBid : hasAsk)) return false;
+            reference = buy ? bid : ask;
+            break;
+        case PegType::Market:
+            if (!(buy ? hasAsk : hasBid)) return false;
+            reference = buy ? ask : bid;
+            break;
+        case PegType::Mid:
+            if (!hasBid || !hasAsk) return false;
+            reference = buy ? (bid + ask) >> 1 : (bid + ask + 1) >> 1;
+            break;
+        default:
+            return false;
+    }
+    
+    // Never lock or cross the opposite displayed touch
+    price = reference + offset;
+    if (buy && hasAsk) price = std::min(price, ask - 1);
+    if (!buy && hasBid) price = std::max(price, bid + 1);
+    return true;
+}
+
+void OrderBook::repegIfMoved() {
+    if (LIKELY(bestBidTick_.load(std::memory_order_relaxed) == pegRefBid_ &&
+               bestAskTick_.load(std::memory_order_relaxed) == pegRefAsk_)) {
+        return;
+    }
+    repricePegs();
+}
+
+void OrderBook::repricePegs() {
+    // O(groups): each group moves as a unit, its orders are not touched
+    pegRefBid_ = bestBidTick_.load(std::memory_order_relaxed);
+    pegRefAsk_ = bestAskTick_.load(std::memory_order_relaxed);
+    for (Side side : {Side::Buy, Side::Sell}) {
+        size_t s = side == Side::Buy ? 0 : 1;
+        for (uint32_t index : activePegGroups_[s]) {
+            PegGroup& g = pegGroups_[s][index];
+            g.priced = pegPrice(side, g.type, g.offset, g.priceTick);
+        }
+        refreshPegBest(side);
+    }
+    uncrossPegs();
+}
+
+void OrderBook::refreshPegBest(Side side) {
+    size_t s = side == Side::Buy ? 0 : 1;
+    int64_t best = s == 0 ? INT64_MIN : INT64_MAX;
+    auto& active = activePegGroups_[s];
+    for (size_t i = 0; i < active.size();) {
+        const PegGroup& g = pegGroups_[s][active[i]];
+        if (g.queue.head == INVALID_SLOT) {
+            // Emptied: retire it so scans stop visiting it
+            freePegGroups_[s].push_back(active[i]);
+            active[i] = active.back();
+            active.pop_back();
+            continue;
+        }
+        if (g.priced) best = s == 0 ? std::max(best, g.priceTick) : std::min(best, g.priceTick);
+        ++i;
+    }
+    pegBest_[s] = best;
+}
+
+void OrderBook::uncrossPegs() {
+    // Pegs on both sides can cross each other inside the spread once their
+    // references move; trade them at the price of whichever rested first
+    if (LIKELY(pegBest_[0] < pegBest_[1])) return;
+    
+    ++pegEpoch_;
+    for (;;) {
+        PegGroup* buy = nextPegGroup(Side::Buy, INT64_MIN);
+        PegGroup* sell = nextPegGroup(Side::Sell, INT64_MAX);
+        if (!buy || !sell || buy->priceTick < sell->priceTick) break;
+        
+        uint32_t buySlot = buy->queue.head;
+        uint32_t sellSlot = sell->queue.head;
+        bool buyIsMaker = pool_[buySlot].timestamp <= pool_[sellSlot].timestamp;
+        PegGroup& makerGroup = buyIsMaker ? *buy : *sell;
+        PegGroup& takerGroup = buyIsMaker ? *sell : *buy;
+        uint32_t makerSlot = buyIsMaker ? buySlot : sellSlot;
+        uint32_t takerSlot = buyIsMaker ? sellSlot : buySlot;
+        
+        // Self-owned pegs stay crossed until one of them moves
+        auto& taker = pool_[takerSlot];
+        if (UNLIKELY(taker.ownerId == pool_[makerSlot].ownerId)) {
+            takerGroup.skipEpoch = pegEpoch_;
+            continue;
+        }
+        
+        // The resting taker enters with its cumulative quantity so reports
+        // keep a running cum, as for amends
+        Order incoming = taker;
+        incoming.quantity = taker.quantity + taker.filledQty;
+        uint32_t remaining = taker.quantity;
+        executeFill(makerGroup.queue, makerSlot, makerGroup.priceTick, incoming, taker.orderId, remaining, nullptr);
+        
+        uint32_t fillQty = taker.quantity - remaining;
+        adjustLevelQuantity(takerGroup.queue, taker, -static_cast<int64_t>(fillQty));
+        taker.quantity = remaining;
+        taker.filledQty += fillQty;
+        if (remaining == 0) {
+            unlinkFromLevel(takerGroup.queue, takerSlot);
+            clientIndex_.erase(taker.ownerId, taker.id);
+            orders_.erase(taker.orderId);
+            pegOrders_[taker.side == Side::Buy ? 0 : 1]--;
+            pool_.release(takerSlot);
+            orderCount_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    refreshPegBest(Side::Buy);
+    refreshPegBest(Side::Sell);
 }
 
 void OrderBook::cancelAll(Side side) {
@@ -348,21 +1805,131 @@ void OrderBook::cancelAll(Side side) {
     std::vector<uint64_t> toCancel;
     
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        for (const auto& [id, order] : orders_) {
-            if (order.side == side) {
-                toCancel.push_back(id);
+        std::lock_guard<BookLock> lock(lock_);
+        wakeLocked();
+        const auto& levels = (side == Side::Buy) ? bids_ : asks_;
+        for (const auto& [price, level] : levels) {
+            for (uint32_t slot = level.head; slot != INVALID_SLOT; slot = pool_[slot].next) {
+                toCancel.push_back(pool_[slot].orderId);
+            }
+        }
+        for (const auto& group : pegGroups_[side == Side::Buy ? 0 : 1]) {
+            for (uint32_t slot = group.queue.head; slot != INVALID_SLOT; slot = pool_[slot].next) {
+                toCancel.push_back(pool_[slot].orderId);
             }
         }
     }
     
     // Cancel each order
     for (uint64_t id : toCancel) {
-        cancelOrder(id);
+        cancelByEngineId(id);
     }
 }
 
+void OrderBook::setFeeEngine(FeeEngine* engine) {
+    std::lock_guard<BookLock> lock(lock_);
+    fees_ = engine;
+}
+
+void OrderBook::setLogger(Logger* logger) {
+    std::lock_guard<BookLock> lock(lock_);
+    logger_ = logger;
+}
+
 void OrderBook::setFillHandler(FillHandler handler) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    fillCb_ = std::move(handler);
+    std::lock_guard<BookLock> lock(lock_);
+    fillCb_ = handler ? std::make_shared<const FillHandler>(std::move(handler)) : nullptr;
+}
+
+void OrderBook::stageFills(FillDispatch& dispatch) {
+    if (UNLIKELY(implied_ != nullptr)) implied_->takeStaged(dispatch.implied);
+    if (LIKELY(pendingFills_.empty())) return;
+    
+    // Hand the staged fills to this operation and refill the staging buffer
+    // from the thread's spare, so steady state does not allocate
+    dispatch.handler = fillCb_;
+    dispatch.fills.swap(pendingFills_);
+    pendingFills_.swap(spareFillBuffer());
+}
+
+void OrderBook::dispatchFills(FillDispatch& dispatch) {
+    if (UNLIKELY(!dispatch.implied.empty())) {
+        for (FillDispatch& other : dispatch.implied) dispatchFills(other);
+        dispatch.implied.clear();
+    }
+    if (LIKELY(dispatch.fills.empty())) return;
+    
+    for (const Fill& fill : dispatch.fills) {
+        (*dispatch.handler)(fill);
+    }
+    
+    dispatch.fills.clear();
+    auto& spare = spareFillBuffer();
+    if (spare.capacity() < dispatch.fills.capacity()) spare.swap(dispatch.fills);
+}
+
+void OrderBook::enableExecutionReports(size_t capacity) {
+    std::lock_guard<BookLock> lock(lock_);
+    reports_ = std::make_unique<ExecutionReportRing>(capacity);
+}
+
+size_t OrderBook::pollExecutionReports(ExecutionReport* out, size_t maxReports) {
+    return reports_ ? reports_->poll(out, maxReports) : 0;
+}
+
+void OrderBook::publishReport(const Order& order, uint64_t orderId, ExecOutcome outcome, RejectReason reason,
+                              uint32_t leaves, uint32_t cum, uint32_t lastQty,
+                              int64_t lastPriceTick, uint64_t timestamp, OrderHandle handle,
+                              Liquidity liquidity, int64_t fee) {
+    if (!reports_) return;
+    
+    ExecutionReport report{
+        ++reportSeq_,
+        orderId,
+        order.id,
+        handle,
+        order.ownerId,
+        order.side,
+        outcome,
+        reason,
+        liquidity,
+        order.priceTick,
+        lastPriceTick,
+        lastQty,
+        leaves,
+        cum,
+        fee,
+        timestamp ? timestamp : getCurrentTimeNs()
+    };
+    reports_->push(report);
+}
+
+ExecutionReportRing::ExecutionReportRing(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+    buffer_.resize(size);
+    mask_ = size - 1;
+}
+
+bool ExecutionReportRing::push(const ExecutionReport& report) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (UNLIKELY(tail - head_.load(std::memory_order_acquire) >= buffer_.size())) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    buffer_[tail & mask_] = report;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+size_t ExecutionReportRing::poll(ExecutionReport* out, size_t maxReports) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    uint64_t available = tail_.load(std::memory_order_acquire) - head;
+    size_t n = static_cast<size_t>(std::min<uint64_t>(available, maxReports));
+    
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = buffer_[(head + i) & mask_];
+    }
+    head_.store(head + n, std::memory_order_release);
+    return n;
 }
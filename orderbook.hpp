@@ -1,30 +1,108 @@
 #pragma once
 #include <cstdint>
+#include <cstring>
+#include <type_traits>
 #include <vector>
 #include <map>
-#include <deque>
 #include <unordered_map>
 #include <functional>
 #include <atomic>
+#include <memory>
 #include <mutex>
+#include <sys/types.h>
+#include "book_lock.hpp"
+#include "client_order_index.hpp"
+#include "counting_allocator.hpp"
+#include "depth_index.hpp"
+#include "order_pool.hpp"
+#include "owner_table.hpp"
 
 
 static constexpr int64_t TICK_PRECISION = 100;
+// Sub-tick resolution for fixed-point mid prices (1 tick = MID_PRECISION sub-ticks)
+static constexpr int64_t MID_PRECISION = 10000;
+// Owner id of the synthetic counterparty on fills against implied liquidity
+static constexpr uint32_t IMPLIED_OWNER_ID = UINT32_MAX;
+
+// Resting orders prefetched ahead of the match cursor; 0 disables prefetching
+#ifndef ORDERBOOK_PREFETCH_DISTANCE
+#define ORDERBOOK_PREFETCH_DISTANCE 4
+#endif
+static constexpr uint32_t PREFETCH_DISTANCE = ORDERBOOK_PREFETCH_DISTANCE;
+
+// Hot-path instrumentation: 1 (full) keeps the Stats counters, the per-order
+// clock reads, the latency histogram and the matching-path log; 0 (lean)
+// compiles all of them out, and Stats then reads zero.
+#ifndef ORDERBOOK_INSTRUMENTATION
+#define ORDERBOOK_INSTRUMENTATION 1
+#endif
+static constexpr bool INSTRUMENTED = ORDERBOOK_INSTRUMENTATION != 0;
 
 enum class Side       { Buy, Sell };
 enum class OrderType  { Limit, Market };
 enum class TimeInForce{ GTC, IOC, FOK, GFD };
+enum class Rounding   { Down, Up, HalfEven };
+
+// Pegged orders track the displayed touch: Primary pegs to the same side's
+// best, Market to the opposite best, Mid to the midpoint (floor for buys,
+// ceiling for sells). pegOffset is added in ticks and priceTick is ignored;
+// amends change size only and reject any priceTick other than the one the
+// order was submitted with.
+enum class PegType : uint8_t { None, Primary, Market, Mid };
+
+// Post-only limits never take liquidity: Reject refuses one that would cross,
+// Reprice moves it to one tick inside the opposite touch instead
+enum class PostOnly : uint8_t { None, Reject, Reprice };
+
+enum class ExecOutcome : uint8_t {
+    Rested,          // accepted, nothing filled, resting on the book
+    PartiallyFilled, // some quantity filled, remainder resting
+    Filled,          // fully filled on entry
+    IocCancelled,    // IOC/FOK remainder cancelled after matching
+    FokRejected,     // FOK could not be fully filled, nothing traded
+    Rejected,        // rejected on entry, see RejectReason
+    Trade,           // one fill against this order (maker or taker)
+    Cancelled,       // cancel request succeeded
+    CancelRejected,  // cancel request failed, see RejectReason
+    Replaced,        // amend applied, see leaves/cum
+    ReplaceRejected  // amend failed, see RejectReason
+};
+
+enum class RejectReason : uint8_t {
+    None,
+    InvalidQuantity,
+    FokNotFillable,
+    UnknownOrder,
+    DuplicateClientOrderId,
+    InvalidOrderFlags,
+    PostOnlyWouldCross,
+    ReduceOnlyWouldIncrease,
+    MinQtyNotFillable,
+    PegPriceNotAmendable
+};
+
+enum class Liquidity : uint8_t { None, Maker, Taker };
 
+class FeeEngine;
+class ComboCoordinator;
+class ImpliedEngine;
+class Logger;
+
+// Order ids in fills and reports are engine-assigned, not client ids
 struct Fill {
     uint64_t makerOrderId;
     uint64_t takerOrderId;
     uint32_t quantity;
     int64_t  priceTick;
     uint64_t timestamp;
+    uint32_t makerOwnerId;
+    uint32_t takerOwnerId;
+    int64_t  makerFee;       // notional units, negative is a rebate; 0 without a fee engine
+    int64_t  takerFee;
 };
 
 struct Order {
-    uint64_t    id;
+    uint64_t    id;          // client order id, unique per ownerId among live orders
     Side        side;
     int64_t     priceTick;
     uint32_t    quantity;
@@ -32,6 +110,31 @@ struct Order {
     TimeInForce tif;
     uint32_t    ownerId;
     uint64_t    timestamp;
+    PegType     peg = PegType::None;
+    int32_t     pegOffset = 0;
+    PostOnly    postOnly = PostOnly::None;
+    bool        reduceOnly = false;  // capped to the owner's position at entry
+    uint32_t    minQty = 0;          // smallest acceptable execution on entry
+};
+
+// One report per outcome or fill; seqNum gaps mean reports were dropped
+struct ExecutionReport {
+    uint64_t     seqNum;
+    uint64_t     orderId;
+    uint64_t     clientOrderId;
+    OrderHandle  handle;        // live while the order rests, else invalid
+    uint32_t     ownerId;
+    Side         side;
+    ExecOutcome  outcome;
+    RejectReason reason;
+    Liquidity    liquidity;     // role on Trade reports
+    int64_t      priceTick;
+    int64_t      lastPriceTick;
+    uint32_t     lastQty;
+    uint32_t     leavesQty;
+    uint32_t     cumQty;
+    int64_t      fee;           // fee charged on this Trade, notional units
+    uint64_t     timestamp;
 };
 
 struct LevelInfo {
@@ -41,29 +144,204 @@ struct LevelInfo {
     uint32_t   padding;
 };
 
+// Tick-denominated best level; valid is false when the side is empty
+struct BestLevel {
+    int64_t    priceTick;
+    uint64_t   totalQuantity;
+    uint32_t   count;
+    bool       valid;
+};
+
+struct TopOfBook {
+    BestLevel  bid;
+    BestLevel  ask;
+};
+
+// Size-weighted mid in sub-ticks (priceTick * MID_PRECISION)
+struct WeightedMid {
+    int64_t    subTicks;
+    bool       valid;
+};
+
+// Result of consuming quantity from one side of the book
+struct PriceImpact {
+    int64_t    worstPriceTick;   // furthest level reached
+    int64_t    vwapSubTicks;     // average price, sub-ticks (priceTick * MID_PRECISION)
+    uint64_t   quantity;         // quantity available up to the request
+    bool       complete;         // false if the side ran out first
+};
+
+// Expected outcome of an aggressive order sweeping the contra side now
+struct ExecutionEstimate {
+    int64_t    avgPriceSubTicks; // average fill price, sub-ticks
+    int64_t    worstPriceTick;   // last level touched
+    uint32_t   levelsConsumed;   // levels touched, including a partial one
+    uint64_t   fillableQty;      // quantity the visible book can absorb
+    double     fillProbability;  // fillableQty / requested, 1.0 when fully fillable
+};
+
+// Heap bytes held by one book, by component. Vectors count their capacity;
+// the engine-id map and the level maps count what their allocator handed
+// out (nodes and buckets, not malloc's own headers). Level FIFOs are linked
+// through the order slots, so they cost nothing beyond orderStorage.
+struct MemoryUsage {
+    size_t   object;           // sizeof(OrderBook)
+    size_t   orderStorage;     // order pool slots
+    size_t   idIndex;          // engine-id map and (owner, clOrdId) index
+    size_t   levels;           // bid and ask level maps
+    size_t   queues;           // peg groups and fill staging
+    size_t   rings;            // execution report ring
+    size_t   depthIndex;
+    size_t   positions;
+    size_t   hibernated;       // serialized image of a hibernated book
+    uint64_t restingOrders;
+    
+    size_t total() const {
+        return object + orderStorage + idIndex + levels + queues + rings + depthIndex + positions + hibernated;
+    }
+    // Whole-book bytes per resting order; 0 for an empty book
+    size_t bytesPerOrder() const { return restingOrders ? total() / restingOrders : 0; }
+};
+
+// Preallocated single-producer/single-consumer report ring. The book
+// produces under its lock; a gateway thread polls without taking it.
+class ExecutionReportRing {
+public:
+    explicit ExecutionReportRing(size_t capacity);
+    
+    bool push(const ExecutionReport& report);
+    size_t poll(ExecutionReport* out, size_t maxReports);
+    
+    size_t capacity() const { return buffer_.size(); }
+    size_t memoryBytes() const { return buffer_.capacity() * sizeof(ExecutionReport); }
+    uint64_t getDropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<ExecutionReport> buffer_;
+    size_t mask_;
+    alignas(64) std::atomic<uint64_t> head_{0};   // next slot to consume
+    alignas(64) std::atomic<uint64_t> tail_{0};   // next slot to produce
+    std::atomic<uint64_t> dropped_{0};
+};
+
 class OrderBook {
 public:
-    OrderBook(size_t maxOrders = 1000000);
+    // Order storage and both id indexes start sized for expectedOrders
+    // (roughly 140 bytes each) and grow on demand. The default is compact,
+    // so an idle book costs a few kilobytes; busy books should pass their
+    // expected peak so growth does not reallocate while trading.
+    static constexpr size_t COMPACT_BOOK_ORDERS = 16;
+    
+    OrderBook(size_t expectedOrders = COMPACT_BOOK_ORDERS, LockPolicy lockPolicy = LockPolicy::Mutex);
     ~OrderBook() = default;
 
-    // Core operations
-    bool submitOrder(const Order& order, std::vector<Fill>* fills = nullptr);
-    bool cancelOrder(uint64_t orderId);
-    std::vector<Fill> modifyOrder(uint64_t orderId, int64_t newPrice, uint32_t newQty);
+    // Core operations. submitOrder returns the handle of the resting
+    // remainder, or an invalid handle if nothing rests (filled/IOC/rejected).
+    // Orders are addressed by client id, resolved through the (owner,
+    // clOrdId) index.
+    OrderHandle submitOrder(const Order& order, std::vector<Fill>* fills = nullptr);
+    bool cancelOrder(uint32_t ownerId, uint64_t clientOrderId);
+    std::vector<Fill> modifyOrder(uint32_t ownerId, uint64_t clientOrderId, int64_t newPrice, uint32_t newQty);
     void cancelAll(Side side);
+    
+    // Engine-id addressed variants. The engine id of a resting order comes
+    // from getEngineOrderId, its fills or its execution reports.
+    bool cancelByEngineId(uint64_t orderId);
+    std::vector<Fill> modifyByEngineId(uint64_t orderId, int64_t newPrice, uint32_t newQty);
+    uint64_t getEngineOrderId(OrderHandle handle) const;   // 0 once the order has left the book
+    
+    // Handle fast paths: the pool slot is resolved from the handle, so
+    // finding the order costs no id lookup. An order that leaves the book
+    // is still unindexed from both id maps, as on every other path. amend
+    // keeps queue priority for a same-price size reduction; otherwise the
+    // order re-enters at the new price under the same handle.
+    bool cancel(OrderHandle handle);
+    bool amend(OrderHandle handle, int64_t newPrice, uint32_t newQty, std::vector<Fill>* fills = nullptr);
+    bool isResting(OrderHandle handle) const;
 
     // Market data access
     double bestBid() const;
     double bestAsk() const;
     std::vector<LevelInfo> getTopLevels(Side side, size_t depth) const;
+
+    // Fixed-point market data (no double conversion, explicit validity)
+    BestLevel getBestBidLevel() const;
+    BestLevel getBestAskLevel() const;
+    TopOfBook getTopOfBook() const;
+    WeightedMid getWeightedMid(Rounding rounding = Rounding::HalfEven) const;
+    // Same mid from a top-of-book already in hand, without the book lock
+    static WeightedMid computeWeightedMid(const BestLevel& bid, const BestLevel& ask, Rounding rounding);
+    
+    // Cumulative depth queries; side is the book side as for getTopLevels.
+    // O(log n) inside the indexed window, a ladder walk without one or while
+    // that side has quantity resting outside it.
+    void enableDepthIndex(int64_t baseTick, size_t numTicks);
+    uint64_t getDepthWithin(Side side, int64_t ticks) const;
+    PriceImpact getPriceImpact(Side side, uint64_t quantity) const;
+    
+    // Cost-to-trade estimates for an order of the given side (Buy sweeps the
+    // asks). Read-only, answered from level aggregates: no order is visited
+    // and self-trade exclusion is not modelled. The batch form prices every
+    // size in one sweep; sizes may come in any order, and ascending input
+    // skips a sort.
+    ExecutionEstimate estimateExecution(Side side, uint64_t quantity) const;
+    void estimateExecution(Side side, const std::vector<uint64_t>& sizes,
+                           std::vector<ExecutionEstimate>& out) const;
+    
+    // Snapshots: versioned binary image of the resting orders in priority
+    // order and of every owner's position. forkSnapshot holds the lock only across fork(); the child writes
+    // its copy-on-write image to path and exits, the caller reaps the pid.
+    // The pause is the fork itself and scales with mapped memory, not with
+    // the number of orders serialised.
+    bool writeSnapshot(int fd) const;
+    bool writeSnapshot(std::vector<char>& out) const;
+    bool loadSnapshot(int fd);
+    bool loadSnapshot(const char* data, size_t size);
+    pid_t forkSnapshot(const char* path);
+    
+    // Idle books: hibernate serializes the book into a snapshot image and
+    // releases its order storage and indexes down to compact size. Level
+    // aggregates and the order count stay, so market data reads still see
+    // the book, and snapshots write the image. The next order operation
+    // (submit, cancel, modify, cancelAll, setPosition, or a combo leg)
+    // revives it. Orders come back in new pool slots, so handles taken
+    // before hibernating go stale; use engine or client ids across it.
+    // Books in an implied engine cannot hibernate.
+    bool hibernate();
+    bool revive();
+    bool isHibernated() const;
     
     // Advanced features
     uint64_t getTotalVolume(Side side) const;
     double getWeightedMidPrice() const;
     uint64_t getOrderCount() const { return orderCount_.load(); }
+    MemoryUsage memoryUsage() const;
 
+    // Fill handlers run after the book lock is released, so they may call
+    // back into the book; matching latency does not depend on them.
     using FillHandler = std::function<void(const Fill&)>;
     void setFillHandler(FillHandler handler);
+
+    // Fees are charged per fill while matching; the engine is not owned and
+    // must only be shared by books that trade on the same thread
+    void setFeeEngine(FeeEngine* engine);
+    
+    // Net filled quantity per owner, used to cap reduce-only orders. Starts
+    // at zero; seed it from the clearing position before trading. Snapshots
+    // carry positions, so a load replaces them. setPosition revives a
+    // hibernated book like an order operation.
+    int64_t getPosition(uint32_t ownerId) const;
+    void setPosition(uint32_t ownerId, int64_t position);
+    
+    // Execution reports (enable before trading starts; polling is lock-free)
+    void enableExecutionReports(size_t capacity = 65536);
+    size_t pollExecutionReports(ExecutionReport* out, size_t maxReports);
+    uint64_t getDroppedReports() const { return reports_ ? reports_->getDropped() : 0; }
+    
+    // Binary log of rejects and fills from the matching path; the logger
+    // must outlive the book or be detached with nullptr first. Lean builds
+    // (ORDERBOOK_INSTRUMENTATION=0) never log.
+    void setLogger(Logger* logger);
     
     // Performance monitoring
     struct Stats {
@@ -72,6 +350,18 @@ public:
         std::atomic<uint64_t> avgProcessingTimeNs{0};
         std::atomic<uint64_t> peakOrdersPerSecond{0};
         
+        // Non-crossing limits that skipped matching entirely
+        std::atomic<uint64_t> passiveOrdersProcessed{0};
+        std::atomic<uint64_t> avgPassiveTimeNs{0};
+        
+        // Matching pause taken by the last forkSnapshot
+        std::atomic<uint64_t> snapshotsTaken{0};
+        std::atomic<uint64_t> lastSnapshotPauseNs{0};
+        
+        // Order processing time, log2 buckets: bucket b counts [2^(b-1), 2^b) ns
+        static constexpr size_t LATENCY_BUCKETS = 32;
+        std::atomic<uint64_t> latencyHistogram[LATENCY_BUCKETS] = {};
+        
         // Copy constructor and assignment deleted for atomics
         Stats() = default;
         Stats(const Stats&) = delete;
@@ -82,6 +372,11 @@ public:
         uint64_t getFillsGenerated() const { return fillsGenerated.load(); }
         uint64_t getAvgProcessingTimeNs() const { return avgProcessingTimeNs.load(); }
         uint64_t getPeakOrdersPerSecond() const { return peakOrdersPerSecond.load(); }
+        uint64_t getPassiveOrdersProcessed() const { return passiveOrdersProcessed.load(); }
+        uint64_t getAvgPassiveTimeNs() const { return avgPassiveTimeNs.load(); }
+        uint64_t getSnapshotsTaken() const { return snapshotsTaken.load(); }
+        uint64_t getLastSnapshotPauseNs() const { return lastSnapshotPauseNs.load(); }
+        uint64_t getLatencyBucket(size_t bucket) const { return latencyHistogram[bucket].load(); }
     };
     
     const Stats& getStats() const { return stats_; }
@@ -90,27 +385,180 @@ public:
         stats_.fillsGenerated = 0;
         stats_.avgProcessingTimeNs = 0;
         stats_.peakOrdersPerSecond = 0;
+        stats_.passiveOrdersProcessed = 0;
+        stats_.avgPassiveTimeNs = 0;
+        stats_.snapshotsTaken = 0;
+        stats_.lastSnapshotPauseNs = 0;
+        for (auto& bucket : stats_.latencyHistogram) bucket = 0;
     }
 
 private:
+    // Combos lock several books and match through submitLocked
+    friend class ComboCoordinator;
+    friend class ImpliedEngine;
+    
+    // Resting order plus the quantity already executed against it
+    struct RestingOrder : Order {
+        uint64_t orderId;
+        uint32_t filledQty;
+        uint32_t pegGroup;   // index into pegGroups_[side] when pegged
+    };
+    
+    // FIFO of pool slots linked through OrderPool::Slot::prev/next
+    struct PriceLevel {
+        uint32_t head = INVALID_SLOT;
+        uint32_t tail = INVALID_SLOT;
+        uint32_t count = 0;
+        uint64_t totalQuantity = 0;
+    };
+    using LevelMap = std::map<int64_t, PriceLevel, std::less<int64_t>,
+                              CountingAllocator<std::pair<const int64_t, PriceLevel>>>;
+    using OrderIdMap = std::unordered_map<uint64_t, uint32_t, std::hash<uint64_t>, std::equal_to<uint64_t>,
+                                          CountingAllocator<std::pair<const uint64_t, uint32_t>>>;
+    
+    // Pegged orders sharing a (type, offset) move as one queue. Pegs are not
+    // displayed: they never set the touch they reference, yield to displayed
+    // orders at the same price, and are clamped so they never lock or cross
+    // the opposite displayed touch.
+    struct PegGroup {
+        PegType type;
+        int32_t offset;
+        int64_t priceTick = 0;
+        bool priced = false;        // false while the reference is missing
+        uint64_t skipEpoch = 0;     // self-match exclusion for one sweep
+        PriceLevel queue;
+    };
+    
+    // Fills staged under the lock for delivery once it is released
+    struct FillDispatch {
+        std::shared_ptr<const FillHandler> handler;
+        std::vector<Fill> fills;
+        std::vector<FillDispatch> implied;   // other books' fills from implied matches
+    };
+    void stageFills(FillDispatch& dispatch);
+    static void dispatchFills(FillDispatch& dispatch);
+    
     // Core matching logic
-    bool canFullyFill(const Order& order) const;
-    void matchLoop(const Order& order, uint32_t& remaining, std::vector<Fill>* fills);
-    void restOrder(const Order& order, uint32_t remaining);
+    OrderHandle submitLocked(const Order& order, std::vector<Fill>* fills);
+    OrderHandle submitAccepted(const Order& order, std::vector<Fill>* fills, uint64_t startTime);
+    OrderHandle submitFlagged(const Order& order, std::vector<Fill>* fills, uint64_t startTime);
+    bool canFill(const Order& order, uint32_t quantity) const;
+    int64_t contraTouch(Side side) const;
+    int64_t reducibleQuantity(uint32_t ownerId, Side side) const;
+    void matchLoop(const Order& order, uint64_t orderId, uint32_t& remaining, std::vector<Fill>* fills);
+    void matchLevel(PriceLevel& level, int64_t priceTick, const Order& incomingOrder,
+                    uint64_t orderId, uint32_t& remaining, std::vector<Fill>* fills);
+    // One fill against the resting order in slot; true if it left the book
+    bool executeFill(PriceLevel& level, uint32_t slot, int64_t priceTick, const Order& incomingOrder,
+                     uint64_t orderId, uint32_t& remaining, std::vector<Fill>* fills);
+    template <typename LevelIt>
+    void prefetchLevels(LevelIt it, LevelIt end) const;
+    uint32_t restOrder(const Order& order, uint64_t orderId, uint32_t remaining, uint32_t filled);
+    void removeOrder(uint32_t slot);
+    bool amendSlot(uint32_t slot, int64_t newPrice, uint32_t newQty, std::vector<Fill>* fills);
+    
+    // Instrumentation hooks; empty unless INSTRUMENTED
+    uint64_t startClock() const;
+    void recordOrder(uint64_t startTime, bool passive);
+    void recordFill(const Fill& fill);
+    void recordReject(const Order& order, RejectReason reason);
     
-    // Thread safe data structures using standard containers + mutex
-    mutable std::mutex mutex_;
-    std::map<int64_t, std::deque<Order*>> bids_;
-    std::map<int64_t, std::deque<Order*>> asks_;
-    std::unordered_map<uint64_t, Order> orders_;
+    void publishReport(const Order& order, uint64_t orderId, ExecOutcome outcome, RejectReason reason,
+                       uint32_t leaves, uint32_t cum, uint32_t lastQty = 0,
+                       int64_t lastPriceTick = 0, uint64_t timestamp = 0,
+                       OrderHandle handle = OrderHandle(),
+                       Liquidity liquidity = Liquidity::None, int64_t fee = 0);
     
-    // Atomic counters for performance
+    // Pegged orders (caller holds lock_)
+    OrderHandle submitPeg(const Order& order, std::vector<Fill>* fills, uint64_t startTime);
+    uint32_t restPeg(const Order& order, uint64_t orderId, uint32_t remaining, uint32_t filled);
+    void unlinkPeg(uint32_t slot);
+    bool amendPeg(uint32_t slot, int64_t newPrice, uint32_t newQty);
+    void matchPegs(Side side, int64_t throughPrice, const Order& incomingOrder,
+                   uint64_t orderId, uint32_t& remaining, std::vector<Fill>* fills);
+    uint32_t pegGroupFor(Side side, PegType type, int32_t offset);
+    PegGroup* nextPegGroup(Side side, int64_t throughPrice);
+    bool pegPrice(Side side, PegType type, int32_t offset, int64_t& price) const;
+    void repegIfMoved();
+    void repricePegs();
+    void refreshPegBest(Side side);
+    void uncrossPegs();
+    bool hasPegs() const { return pegOrders_[0] + pegOrders_[1] != 0; }
+    
+    // Implied liquidity (caller holds lock_)
+    void matchImplied(Side side, int64_t throughPrice, const Order& incomingOrder,
+                      uint64_t orderId, uint32_t& remaining, std::vector<Fill>* fills);
+    uint32_t fillImpliedLeg(Side takerSide, uint32_t quantity);
+    
+    // Level queue maintenance
+    PriceLevel& levelFor(Side side, int64_t priceTick);
+    void adjustLevelQuantity(PriceLevel& level, const Order& order, int64_t delta);
+    void appendToLevel(PriceLevel& level, uint32_t slot);
+    void unlinkFromLevel(PriceLevel& level, uint32_t slot);
+    void refreshBestTick(Side side);
+
+    // Market data helpers (caller holds lock_)
+    BestLevel bestLevel(Side side) const;
+    void estimateSorted(Side side, const uint64_t* sizes, size_t count, ExecutionEstimate* out) const;
+    
+    // Snapshot helpers (caller holds lock_, or is a forked child)
+    template<typename Writer> bool serializeTo(Writer& out) const;
+    template<typename Reader> bool deserializeFrom(Reader& in);
+    template<typename Reader> bool deserializeLocked(Reader& in);
+    void clearLocked();
+    bool reviveLocked();
+    void wakeLocked();
+    
+    // Thread safe data structures using standard containers + book lock
+    mutable BookLock lock_;
+    size_t levelBytes_ = 0;                           // bids_ and asks_ allocations
+    size_t orderIdBytes_ = 0;                         // orders_ allocations
+    LevelMap bids_;
+    LevelMap asks_;
+    OrderPool<RestingOrder> pool_;
+    OrderIdMap orders_;                               // engine id -> pool slot
+    ClientOrderIndex clientIndex_;                    // (owner, clOrdId) -> pool slot
+    DepthIndex depthIndex_;
+    uint64_t nextOrderId_ = 1;
+    
+    // Peg groups per side (0 = bids) and the displayed touch they were
+    // last priced from; pegBest is INT64_MIN/INT64_MAX with no priced pegs.
+    // Scans only visit the active groups; refreshPegBest retires emptied
+    // ones to the free list, and pegGroupFor reuses them.
+    std::vector<PegGroup> pegGroups_[2];
+    std::vector<uint32_t> activePegGroups_[2];
+    std::vector<uint32_t> freePegGroups_[2];
+    uint64_t pegOrders_[2] = {0, 0};
+    int64_t pegBest_[2] = {INT64_MIN, INT64_MAX};
+    int64_t pegRefBid_ = INT64_MIN;
+    int64_t pegRefAsk_ = INT64_MAX;
+    uint64_t pegEpoch_ = 0;
+    
+    // Implied engine this book takes part in; topVersion is bumped whenever
+    // either touch changes price or quantity
+    ImpliedEngine* implied_ = nullptr;
+    uint64_t topVersion_ = 0;
+    
+    // Atomic counters for performance. Best ticks are maintained under the
+    // lock on every level change; INT64_MIN/INT64_MAX mean the side is empty.
     std::atomic<uint64_t> orderCount_{0};
-    std::atomic<int64_t> bestBidTick_{0};
+    std::atomic<int64_t> bestBidTick_{INT64_MIN};
     std::atomic<int64_t> bestAskTick_{INT64_MAX};
     
     mutable Stats stats_;
-    FillHandler fillCb_;
+    std::shared_ptr<const FillHandler> fillCb_;
+    std::vector<Fill> pendingFills_;
+    
+    FeeEngine* fees_ = nullptr;
+    Logger* logger_ = nullptr;
+    OwnerTable<int64_t> positions_;                   // net filled quantity by owner
+    
+    std::unique_ptr<ExecutionReportRing> reports_;
+    uint64_t reportSeq_ = 0;
+    
+    // Snapshot image while hibernated
+    bool hibernated_ = false;
+    std::vector<char> hibernateImage_;
     
     // Utility functions
     uint64_t getCurrentTimeNs() const;
@@ -121,13 +569,80 @@ namespace HFTUtils {
 #if defined(__GNUC__) || defined(__clang__)
     #define LIKELY(x)   __builtin_expect(!!(x), 1)
     #define UNLIKELY(x) __builtin_expect(!!(x), 0)
+    #define PREFETCH(addr) __builtin_prefetch((addr), 1, 3)
 #else
     #define LIKELY(x)   (x)
     #define UNLIKELY(x) (x)
+    #define PREFETCH(addr) ((void)(addr))
 #endif
     
     // Memory barriers
     inline void memoryBarrier() {
         std::atomic_thread_fence(std::memory_order_acq_rel);
     }
+    
+    // Integer division with an explicit rounding mode (den > 0)
+    inline int64_t divideRounded(__int128 num, __int128 den, Rounding rounding) {
+        // Floor division first, then adjust the remainder per rounding mode
+        __int128 q = num / den;
+        __int128 r = num % den;
+        if (r < 0) { q -= 1; r += den; }
+        
+        if (r != 0) {
+            switch (rounding) {
+                case Rounding::Down:
+                    break;
+                case Rounding::Up:
+                    q += 1;
+                    break;
+                case Rounding::HalfEven:
+                    if (2 * r > den || (2 * r == den && (q & 1))) q += 1;
+                    break;
+            }
+        }
+        return static_cast<int64_t>(q);
+    }
+    
+    // Single-writer sequence lock over a trivially copyable value. Readers
+    // never block the writer and retry if a store overlapped their copy;
+    // the value is moved as relaxed atomic words so the race is defined.
+    template <typename T>
+    class SeqLock {
+        static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+    public:
+        void store(const T& value) {
+            uint64_t words[WORDS] = {};
+            std::memcpy(words, &value, sizeof(T));
+            uint64_t seq = seq_.load(std::memory_order_relaxed);
+            seq_.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < WORDS; ++i) words_[i].store(words[i], std::memory_order_relaxed);
+            seq_.store(seq + 2, std::memory_order_release);
+        }
+        
+        T load() const {
+            uint64_t words[WORDS];
+            uint64_t before, after;
+            do {
+                before = seq_.load(std::memory_order_acquire);
+                for (size_t i = 0; i < WORDS; ++i) words[i] = words_[i].load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                after = seq_.load(std::memory_order_relaxed);
+            } while ((before & 1) || before != after);
+            
+            T value;
+            std::memcpy(&value, words, sizeof(T));
+            return value;
+        }
+        
+    private:
+        static constexpr size_t WORDS = (sizeof(T) + 7) / 8;
+        alignas(64) std::atomic<uint64_t> seq_{0};
+        std::atomic<uint64_t> words_[WORDS] = {};
+    };
+}
+
+// Revives a hibernated book before an order operation (caller holds lock_)
+inline void OrderBook::wakeLocked() {
+    if (UNLIKELY(hibernated_)) reviveLocked();
 }
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+// Open-addressing hash of owner id -> Value. Owner ids are arbitrary 32-bit
+// values, so anything kept per owner lives here rather than in an array
+// indexed by id: the table holds one entry per owner seen, at most half
+// full. Entries are never removed. References from at() and find() stay
+// valid until the next insertion.
+template <typename Value>
+class OwnerTable {
+public:
+    explicit OwnerTable(size_t expected = 8) {
+        size_t capacity = 16;
+        while (capacity < expected * 2) capacity <<= 1;
+        entries_.resize(capacity);
+        mask_ = capacity - 1;
+    }
+
+    const Value* find(uint32_t ownerId) const {
+        for (size_t i = hash(ownerId) & mask_;; i = (i + 1) & mask_) {
+            const Entry& e = entries_[i];
+            if (!e.used) return nullptr;
+            if (e.ownerId == ownerId) return &e.value;
+        }
+    }
+
+    Value* find(uint32_t ownerId) {
+        return const_cast<Value*>(static_cast<const OwnerTable&>(*this).find(ownerId));
+    }
+
+    // Copy of the owner's value, or a default one for owners never seen
+    Value get(uint32_t ownerId) const {
+        const Value* value = find(ownerId);
+        return value ? *value : Value{};
+    }
+
+    // Value for ownerId, default-constructed on first use
+    Value& at(uint32_t ownerId) {
+        for (size_t i = hash(ownerId) & mask_;; i = (i + 1) & mask_) {
+            Entry& e = entries_[i];
+            if (e.used && e.ownerId == ownerId) return e.value;
+            if (e.used) continue;
+
+            if ((size_ + 1) * 2 > entries_.size()) {
+                grow();
+                return at(ownerId);
+            }
+            e.ownerId = ownerId;
+            e.used = 1;
+            e.value = Value{};
+            ++size_;
+            return e.value;
+        }
+    }
+
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (const Entry& e : entries_) {
+            if (e.used) fn(e.ownerId, e.value);
+        }
+    }
+
+    void clear() {
+        for (Entry& e : entries_) e = Entry{};
+        size_ = 0;
+    }
+
+    size_t size() const { return size_; }
+    size_t memoryBytes() const { return entries_.capacity() * sizeof(Entry); }
+
+private:
+    struct Entry {
+        uint32_t ownerId = 0;
+        uint32_t used = 0;
+        Value value{};
+    };
+
+    static size_t hash(uint32_t ownerId) {
+        uint64_t h = ownerId;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return static_cast<size_t>(h);
+    }
+
+    void grow() {
+        std::vector<Entry> old;
+        old.swap(entries_);
+        entries_.resize(old.size() * 2);
+        mask_ = entries_.size() - 1;
+        size_ = 0;
+        for (Entry& e : old) {
+            if (e.used) at(e.ownerId) = std::move(e.value);
+        }
+    }
+
+    std::vector<Entry> entries_;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+};
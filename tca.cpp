@@ -0,0 +1,152 @@
+#include "tca.hpp"
+
+namespace {
+    const TcaMetrics EMPTY_METRICS{};
+
+    bool isTerminal(ExecOutcome outcome) {
+        return outcome == ExecOutcome::Filled || outcome == ExecOutcome::IocCancelled ||
+               outcome == ExecOutcome::Cancelled;
+    }
+}
+
+TcaEngine::TcaEngine(const Horizons& horizonsNs, size_t expectedOrders)
+    : horizons_(horizonsNs), arrivalIndex_(expectedOrders) {
+    arrivals_.reserve(expectedOrders);
+}
+
+void TcaEngine::setStrategy(uint32_t ownerId, uint32_t strategyId) {
+    strategyOf_.at(ownerId) = strategyId;
+}
+
+void TcaEngine::onQuote(uint64_t timestamp, const TopOfBook& quote) {
+    quote_ = quote;
+    midValid_ = quote.bid.valid && quote.ask.valid;
+    if (midValid_) {
+        midSubTicks_ = (quote.bid.priceTick + quote.ask.priceTick) * (MID_PRECISION / 2);
+        completeMarkouts(timestamp);
+    }
+}
+
+void TcaEngine::onExecutionReport(const ExecutionReport& report) {
+    switch (report.outcome) {
+        case ExecOutcome::Rejected:
+        case ExecOutcome::FokRejected:
+        case ExecOutcome::CancelRejected:
+        case ExecOutcome::ReplaceRejected:
+            return;
+        default:
+            break;
+    }
+
+    if (isTerminal(report.outcome)) {
+        releaseArrival(report);
+        return;
+    }
+
+    uint32_t index = arrivalFor(report);
+    if (report.outcome == ExecOutcome::Trade) {
+        recordFill(report, arrivals_[index]);
+        // Makers get no report after their last trade
+        if (report.leavesQty == 0) releaseArrival(report);
+    }
+}
+
+uint32_t TcaEngine::arrivalFor(const ExecutionReport& report) {
+    uint32_t index = arrivalIndex_.find(report.ownerId, report.clientOrderId);
+    if (index != ClientOrderIndex::NOT_FOUND) return index;
+
+    // First sighting: the latest quote is the book state the order arrived into
+    if (freeArrival_ != ClientOrderIndex::NOT_FOUND) {
+        index = freeArrival_;
+        freeArrival_ = arrivals_[index].nextFree;
+    } else {
+        index = static_cast<uint32_t>(arrivals_.size());
+        arrivals_.emplace_back();
+    }
+    const BestLevel& contra = report.side == Side::Buy ? quote_.ask : quote_.bid;
+    arrivals_[index] = {midSubTicks_, quote_.ask.priceTick - quote_.bid.priceTick,
+                        contra.valid ? contra.totalQuantity : 0, midValid_,
+                        ClientOrderIndex::NOT_FOUND};
+    arrivalIndex_.insert(report.ownerId, report.clientOrderId, index);
+    return index;
+}
+
+void TcaEngine::releaseArrival(const ExecutionReport& report) {
+    uint32_t index = arrivalIndex_.find(report.ownerId, report.clientOrderId);
+    if (index == ClientOrderIndex::NOT_FOUND) return;
+    arrivalIndex_.erase(report.ownerId, report.clientOrderId);
+    arrivals_[index].nextFree = freeArrival_;
+    freeArrival_ = index;
+}
+
+void TcaEngine::recordFill(const ExecutionReport& report, const Arrival& arrival) {
+    int8_t sign = report.side == Side::Buy ? 1 : -1;
+    int64_t price = report.lastPriceTick * MID_PRECISION;
+    uint32_t qty = report.lastQty;
+    uint32_t strategyId = strategyOf(report.ownerId);
+
+    for (TcaMetrics* m : {&ownerSlot(report.ownerId), &strategySlot(strategyId)}) {
+        m->fills++;
+        m->quantity += qty;
+        if (arrival.valid) {
+            m->shortfallQty += qty;
+            m->shortfall += (__int128)sign * (price - arrival.midSubTicks) * qty;
+            m->arrivalSpread += (__int128)arrival.spreadTicks * MID_PRECISION * qty;
+            m->arrivalDepth += (__int128)arrival.contraDepth * qty;
+        }
+        if (midValid_) {
+            m->spreadQty += qty;
+            m->effectiveSpread += (__int128)2 * sign * (price - midSubTicks_) * qty;
+        }
+    }
+
+    for (size_t h = 0; h < MARKOUT_HORIZONS; ++h) {
+        pending_[h].push({report.timestamp + horizons_[h], price, qty, report.ownerId, strategyId, sign});
+    }
+}
+
+void TcaEngine::completeMarkouts(uint64_t timestamp) {
+    for (size_t h = 0; h < MARKOUT_HORIZONS; ++h) {
+        MarkoutRing& ring = pending_[h];
+        while (!ring.empty() && ring.front().dueTimestamp <= timestamp) {
+            const PendingMarkout& p = ring.front();
+            __int128 value = (__int128)p.sign * (midSubTicks_ - p.priceSubTicks) * p.quantity;
+            for (TcaMetrics* m : {&ownerSlot(p.ownerId), &strategySlot(p.strategyId)}) {
+                m->markoutQty[h] += p.quantity;
+                m->markout[h] += value;
+            }
+            ring.pop();
+        }
+    }
+}
+
+void TcaEngine::MarkoutRing::push(const PendingMarkout& m) {
+    if (tail_ - head_ == buffer_.size()) {
+        // Unwrap into a buffer twice the size
+        std::vector<PendingMarkout> grown(buffer_.size() * 2);
+        for (size_t i = head_; i != tail_; ++i) grown[i - head_] = buffer_[i & mask_];
+        tail_ -= head_;
+        head_ = 0;
+        buffer_.swap(grown);
+        mask_ = buffer_.size() - 1;
+    }
+    buffer_[tail_++ & mask_] = m;
+}
+
+TcaMetrics& TcaEngine::ownerSlot(uint32_t ownerId) {
+    return byOwner_.at(ownerId);
+}
+
+TcaMetrics& TcaEngine::strategySlot(uint32_t strategyId) {
+    return byStrategy_.at(strategyId);
+}
+
+const TcaMetrics& TcaEngine::ownerMetrics(uint32_t ownerId) const {
+    const TcaMetrics* metrics = byOwner_.find(ownerId);
+    return metrics ? *metrics : EMPTY_METRICS;
+}
+
+const TcaMetrics& TcaEngine::strategyMetrics(uint32_t strategyId) const {
+    const TcaMetrics* metrics = byStrategy_.find(strategyId);
+    return metrics ? *metrics : EMPTY_METRICS;
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "client_order_index.hpp"
+#include "orderbook.hpp"
+#include "owner_table.hpp"
+
+
+static constexpr size_t MARKOUT_HORIZONS = 4;
+
+// Qty-weighted sums in sub-ticks, signed so that positive shortfall and
+// spread are costs and positive markouts are favourable to the order
+struct TcaMetrics {
+    uint64_t fills = 0;
+    uint64_t quantity = 0;
+
+    uint64_t shortfallQty = 0;          // fills with a valid arrival mid
+    __int128 shortfall = 0;             // side * (price - arrival mid)
+    __int128 arrivalSpread = 0;         // quoted spread at arrival
+    __int128 arrivalDepth = 0;          // contra touch quantity at arrival
+
+    uint64_t spreadQty = 0;             // fills with a valid mid at execution
+    __int128 effectiveSpread = 0;       // 2 * side * (price - mid)
+
+    std::array<uint64_t, MARKOUT_HORIZONS> markoutQty{};
+    std::array<__int128, MARKOUT_HORIZONS> markout{};   // side * (mid after horizon - price)
+
+    // Per-unit averages, sub-ticks (0 when nothing has been measured)
+    int64_t avgShortfall() const { return average(shortfall, shortfallQty); }
+    int64_t avgEffectiveSpread() const { return average(effectiveSpread, spreadQty); }
+    int64_t avgMarkout(size_t horizon) const { return average(markout[horizon], markoutQty[horizon]); }
+
+private:
+    static int64_t average(__int128 sum, uint64_t qty) {
+        return qty ? HFTUtils::divideRounded(sum, qty, Rounding::HalfEven) : 0;
+    }
+};
+
+// Streaming transaction cost analysis over execution reports and top-of-book
+// updates. Each order's arrival state (mid, spread, contra touch depth) is
+// captured on its first report; each Trade report is costed against it and
+// against the mid at execution, then queued per horizon and marked out by
+// the first quote at or after fill time + horizon. Horizon queues are FIFO
+// rings, so work per fill and per quote is O(1) amortised.
+//
+// Single-threaded: feed it from the report consumer. Owner and strategy ids
+// are hashed, so any 32-bit value is fine. Timestamps share the book's clock.
+class TcaEngine {
+public:
+    using Horizons = std::array<uint64_t, MARKOUT_HORIZONS>;
+    static constexpr Horizons DEFAULT_HORIZONS = {
+        100000000ULL, 1000000000ULL, 10000000000ULL, 60000000000ULL   // 100ms 1s 10s 60s
+    };
+
+    explicit TcaEngine(const Horizons& horizonsNs = DEFAULT_HORIZONS, size_t expectedOrders = 4096);
+
+    void setStrategy(uint32_t ownerId, uint32_t strategyId);
+
+    void onQuote(uint64_t timestamp, const TopOfBook& quote);
+    void onExecutionReport(const ExecutionReport& report);
+
+    // Empty metrics for ids never seen
+    const TcaMetrics& ownerMetrics(uint32_t ownerId) const;
+    const TcaMetrics& strategyMetrics(uint32_t strategyId) const;
+    const Horizons& horizons() const { return horizons_; }
+    size_t pendingMarkouts(size_t horizon) const { return pending_[horizon].size(); }
+
+private:
+    struct Arrival {
+        int64_t midSubTicks;
+        int64_t spreadTicks;
+        uint64_t contraDepth;
+        bool valid;
+        uint32_t nextFree;
+    };
+
+    struct PendingMarkout {
+        uint64_t dueTimestamp;
+        int64_t priceSubTicks;
+        uint32_t quantity;
+        uint32_t ownerId;
+        uint32_t strategyId;
+        int8_t sign;
+    };
+
+    // Growable FIFO ring; capacity doubles when full
+    class MarkoutRing {
+    public:
+        MarkoutRing() : buffer_(64), mask_(63) {}
+
+        bool empty() const { return head_ == tail_; }
+        size_t size() const { return tail_ - head_; }
+        const PendingMarkout& front() const { return buffer_[head_ & mask_]; }
+        void pop() { ++head_; }
+        void push(const PendingMarkout& m);
+
+    private:
+        std::vector<PendingMarkout> buffer_;
+        size_t mask_;
+        size_t head_ = 0;
+        size_t tail_ = 0;
+    };
+
+    uint32_t arrivalFor(const ExecutionReport& report);
+    void releaseArrival(const ExecutionReport& report);
+    void recordFill(const ExecutionReport& report, const Arrival& arrival);
+    void completeMarkouts(uint64_t timestamp);
+
+    TcaMetrics& ownerSlot(uint32_t ownerId);
+    TcaMetrics& strategySlot(uint32_t strategyId);
+    uint32_t strategyOf(uint32_t ownerId) const { return strategyOf_.get(ownerId); }
+
+    Horizons horizons_;
+
+    // Latest quote
+    TopOfBook quote_{};
+    int64_t midSubTicks_ = 0;
+    bool midValid_ = false;
+
+    // Live orders' arrival state, keyed (owner, clOrdId) like the book
+    ClientOrderIndex arrivalIndex_;
+    std::vector<Arrival> arrivals_;
+    uint32_t freeArrival_ = ClientOrderIndex::NOT_FOUND;
+
+    std::array<MarkoutRing, MARKOUT_HORIZONS> pending_;
+
+    OwnerTable<uint32_t> strategyOf_;
+    OwnerTable<TcaMetrics> byOwner_;
+    OwnerTable<TcaMetrics> byStrategy_;     // keyed by strategy id
+};